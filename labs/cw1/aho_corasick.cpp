@@ -0,0 +1,130 @@
+#include "aho_corasick.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+#include "text.h"
+
+aho_corasick::aho_corasick(const std::vector<std::string_view>& words)
+{
+    // Build the alphabet from the folded characters actually used in the words
+    memset(classOf, 0, sizeof(classOf));
+    for (auto word : words)
+        for (char c : word)
+        {
+            auto f = uint8_t(fold_case(c));
+            if (classOf[f] == 0)
+                classOf[f] = uint16_t(numClasses++);
+        }
+    // Upper case letters share the class of their lower case counterpart
+    for (int c = 'A'; c <= 'Z'; ++c)
+        classOf[c] = classOf[c | 0x20];
+
+    auto add_state = [&](int32_t d) {
+        next.resize(next.size() + numClasses, -1);
+        depth.push_back(d);
+        firstMatch.push_back(-1);
+        nextMatch.push_back(-1);
+        return int32_t(depth.size() - 1);
+    };
+    add_state(0);
+
+    // Build the trie. Empty words match nothing, so they stay on the root and never get counted
+    wordState.reserve(words.size());
+    for (auto word : words)
+    {
+        int32_t state = 0;
+        for (char c : word)
+        {
+            auto& target = next[state * numClasses + classOf[uint8_t(c)]];
+            if (target < 0)
+            {
+                auto newState = add_state(depth[state] + 1);
+                // add_state() may have reallocated the table, so don't use the reference
+                next[state * numClasses + classOf[uint8_t(c)]] = newState;
+                state = newState;
+            }
+            else
+                state = target;
+        }
+        if (state != 0)
+            firstMatch[state] = state;
+        maxDepth = std::max(maxDepth, depth[state]);
+        wordState.push_back(state);
+    }
+
+    // Breadth-first pass turns the trie into a complete DFA: missing transitions borrow the transition of
+    // the failure state, which is always shallower and thus already complete.
+    std::vector<int32_t> fail(depth.size(), 0);
+    std::queue<int32_t> pending;
+    for (int c = 0; c < numClasses; ++c)
+    {
+        auto& target = next[c];
+        if (target < 0)
+            target = 0;
+        else
+            pending.push(target);
+    }
+    while (!pending.empty())
+    {
+        auto state = pending.front();
+        pending.pop();
+        auto f = fail[state];
+        // Chain word-ending states along the failure links
+        if (firstMatch[state] == state)
+            nextMatch[state] = firstMatch[f];
+        else
+            firstMatch[state] = firstMatch[f];
+        for (int c = 0; c < numClasses; ++c)
+        {
+            auto& target = next[state * numClasses + c];
+            if (target < 0)
+                target = next[f * numClasses + c];
+            else
+            {
+                fail[target] = next[f * numClasses + c];
+                pending.push(target);
+            }
+        }
+    }
+}
+
+std::vector<size_t> aho_corasick::count(std::string_view data, size_t begin, size_t end) const
+{
+    std::vector<size_t> stateHits(depth.size(), 0);
+    const char* text = data.data();
+    // Starting from the root at begin finds every match that lies after begin. Matches starting
+    // before end can run up to maxDepth - 1 bytes past it.
+    end = std::min(end, data.size());
+    const size_t size = std::min(data.size(), end + std::max(maxDepth, 1) - 1);
+    const int32_t* table = next.data();
+    const int32_t* matches = firstMatch.data();
+
+    int32_t state = 0;
+    for (size_t i = begin; i < size; ++i)
+    {
+        state = table[state * numClasses + classOf[uint8_t(text[i])]];
+        auto m = matches[state];
+        if (m < 0)
+            continue;
+        // Something ends at i: the suffix test is shared by every word ending here
+        if (i + 1 < data.size() && is_letter(text[i + 1]))
+            continue;
+        for (; m >= 0; m = nextMatch[m])
+        {
+            size_t start = i + 1 - depth[m];
+            if (start >= end)
+                continue;
+            if (start > 0 && is_letter(text[start - 1]))
+                continue;
+            ++stateHits[m];
+        }
+    }
+
+    std::vector<size_t> counts(wordState.size(), 0);
+    for (size_t w = 0; w < wordState.size(); ++w)
+        if (wordState[w] != 0)
+            counts[w] = stateHits[wordState[w]];
+    return counts;
+}
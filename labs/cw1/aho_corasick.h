@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Aho-Corasick automaton that counts a whole word list in a single pass over the corpus, with the
+// same case folding and letter-boundary rules as calc_token_occurrences.
+//
+// The automaton is a complete DFA stored as one flat row-major transition table. Bytes are first
+// mapped to a small alphabet (one class per distinct folded character in the words, plus one for
+// everything else), so each row is only a few dozen entries and the hot rows stay in L1.
+class aho_corasick
+{
+private:
+    // byte -> alphabet class. Class 0 is "not in any word" and always leads back towards the root.
+    // 16 bits, since words using every byte value would need 257 classes.
+    uint16_t classOf[256];
+    int numClasses = 1;
+    // next[state * numClasses + class] -> state
+    std::vector<int32_t> next;
+    // For each state, the longest state on its failure chain (itself included) that ends a word, or -1
+    std::vector<int32_t> firstMatch;
+    // For each word-ending state, the next shorter word-ending state on its failure chain, or -1
+    std::vector<int32_t> nextMatch;
+    // Depth of each state, i.e. the length of the word it spells
+    std::vector<int32_t> depth;
+    // The state each input word ends in (duplicates share one)
+    std::vector<int32_t> wordState;
+    // Length of the longest word
+    int32_t maxDepth = 0;
+public:
+    explicit aho_corasick(const std::vector<std::string_view>& words);
+
+    // Number of occurrences of each word, in the order the words were given. Only matches starting in
+    // [begin, end) are counted, but the bytes around the range are still read for the boundary tests,
+    // so adjacent ranges add up to the count of the whole corpus.
+    std::vector<size_t> count(std::string_view data, size_t begin = 0, size_t end = SIZE_MAX) const;
+
+    size_t num_states() const { return depth.size(); }
+    size_t max_word_length() const { return size_t(maxDepth); }
+};
@@ -0,0 +1,381 @@
+#include "async_read.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "aho_corasick.h"
+#include "parallel.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Alignment of the buffers, file offsets and lengths, as O_DIRECT wants them
+constexpr size_t IO_ALIGNMENT = 4096;
+
+static size_t align_up(size_t n)
+{
+    return (n + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+}
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define CW1_IO_URING
+
+// Just enough of io_uring for reads, on the raw system calls (no liburing): a submission ring of read
+// requests and a completion ring of results, both shared with the kernel
+class read_ring
+{
+private:
+    int fd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    size_t sqRingSize = 0, cqRingSize = 0;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned toSubmit = 0;
+public:
+    read_ring() = default;
+    read_ring(const read_ring&) = delete;
+    read_ring& operator=(const read_ring&) = delete;
+    ~read_ring()
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    // False if the kernel doesn't support io_uring (or it's disabled, e.g. in a container)
+    bool init(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+            return false;
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap)
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+            return false;
+        cqRing = singleMap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED)
+            return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+
+        auto sq = (char*)sqRing;
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        auto cq = (char*)cqRing;
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Queue a read, sent to the kernel by the next submit(). There must be fewer requests outstanding than ring entries.
+    void prepare_read(int file, void* buffer, size_t length, uint64_t offset, uint64_t userData)
+    {
+        // Only this thread writes the tail; the kernel reads it
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        auto& sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = file;
+        sqe.addr = uint64_t(uintptr_t(buffer));
+        sqe.len = unsigned(length);
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++toSubmit;
+    }
+
+    // Send the queued reads, and wait until at least minComplete results are in. Returns false on error.
+    bool submit(unsigned minComplete)
+    {
+        int result;
+        do
+            result = int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        while (result < 0 && errno == EINTR);
+        if (result < 0)
+            return false;
+        toSubmit -= unsigned(result) < toSubmit ? unsigned(result) : toSubmit;
+        return true;
+    }
+
+    // Take the next result if there is one: the request's user data and the bytes read (or -errno)
+    bool pop(uint64_t& userData, int& result)
+    {
+        unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+            return false;
+        auto& cqe = cqes[head & *cqMask];
+        userData = cqe.user_data;
+        result = cqe.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+
+#endif
+
+// A buffer of the ring and the block it holds: counting covers window[begin, end)
+struct read_block
+{
+    char* data;
+    std::string_view window;
+    size_t begin = 0, end = 0;
+};
+
+std::vector<size_t> count_words_async(const char* filename, const std::vector<std::string_view>& words, const async_read_options& options)
+{
+    aho_corasick matcher(words);
+    // Blocks are read with an aligned page before them (for the prefix test of their first position) and
+    // enough pages after them for the longest match and its suffix byte
+    const size_t blockSize = align_up(std::max<size_t>(options.blockSize, 1));
+    const size_t lookahead = align_up(matcher.max_word_length() + 1);
+    const size_t bufferSize = IO_ALIGNMENT + blockSize + lookahead;
+    const unsigned queueDepth = std::max(1u, options.queueDepth);
+    const unsigned numWorkers = options.numThreads ? options.numThreads : default_num_threads();
+
+#ifdef CW1_IO_URING
+    int file = ::open(filename, O_RDONLY | (options.direct ? O_DIRECT : 0));
+    // Not every file system supports O_DIRECT
+    if (file < 0 && options.direct)
+        file = ::open(filename, O_RDONLY);
+    struct stat fileStat;
+    if (file < 0 || fstat(file, &fileStat) != 0)
+    {
+        std::cerr << "Error: Could not open the file " << filename << std::endl;
+        if (file >= 0)
+            ::close(file);
+        return {};
+    }
+    const size_t fileSize = size_t(fileStat.st_size);
+    read_ring ring;
+    bool useRing = ring.init(queueDepth);
+#else
+    std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+    if (!stream)
+    {
+        std::cerr << "Error: Could not open the file " << filename << std::endl;
+        return {};
+    }
+    const size_t fileSize = size_t(stream.tellg());
+#endif
+    const size_t numBlocks = (fileSize + blockSize - 1) / blockSize;
+
+    // Ring of buffers: enough for the reads in flight and one per worker
+    const size_t numBuffers = std::min<size_t>(std::max<size_t>(numBlocks, 1), queueDepth + numWorkers);
+    std::vector<std::unique_ptr<char[]>> storage;
+    std::vector<read_block> blocks(numBuffers);
+    for (auto& b : blocks)
+    {
+        storage.emplace_back(new char[bufferSize + IO_ALIGNMENT]);
+        b.data = (char*)align_up(size_t(uintptr_t(storage.back().get())));
+    }
+
+    // Free buffers for the reader, filled ones for the workers
+    std::mutex mutex;
+    std::condition_variable freeReady, filledReady;
+    std::vector<size_t> freeBuffers;
+    for (size_t i = 0; i < numBuffers; ++i)
+        freeBuffers.push_back(i);
+    std::deque<size_t> filledBuffers;
+    bool finished = false;
+    std::atomic<bool> failed(false);
+
+    std::vector<std::vector<size_t>> workerCounts(numWorkers, std::vector<size_t>(words.size(), 0));
+    auto worker = [&](unsigned w) {
+        for (;;)
+        {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                filledReady.wait(lock, [&] { return !filledBuffers.empty() || finished; });
+                if (filledBuffers.empty())
+                    return;
+                index = filledBuffers.front();
+                filledBuffers.pop_front();
+            }
+            auto& b = blocks[index];
+            auto counts = matcher.count(b.window, b.begin, b.end);
+            for (size_t i = 0; i < counts.size(); ++i)
+                workerCounts[w][i] += counts[i];
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeBuffers.push_back(index);
+            }
+            freeReady.notify_one();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < numWorkers; ++w)
+        workers.emplace_back(worker, w);
+
+    // Where block k is read from and to, and what of it is counted
+    auto block_range = [&](size_t k, size_t& readStart, size_t& readLength, read_block& b) {
+        size_t blockStart = k * blockSize;
+        readStart = k > 0 ? blockStart - IO_ALIGNMENT : 0;
+        readLength = std::min(fileSize, blockStart + blockSize + lookahead) - readStart;
+        b.begin = blockStart - readStart;
+        b.end = b.begin + std::min(blockSize, fileSize - blockStart);
+    };
+    auto take_free_buffer = [&](bool wait, size_t& index) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (wait)
+            freeReady.wait(lock, [&] { return !freeBuffers.empty(); });
+        if (freeBuffers.empty())
+            return false;
+        index = freeBuffers.back();
+        freeBuffers.pop_back();
+        return true;
+    };
+    auto hand_over = [&](size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            filledBuffers.push_back(index);
+        }
+        filledReady.notify_one();
+    };
+    // Blocking read of the rest of a block, for short reads and when io_uring isn't available
+    auto read_rest = [&](size_t index, size_t done, size_t readStart, size_t readLength) {
+        auto& b = blocks[index];
+        while (done < readLength)
+        {
+#ifdef CW1_IO_URING
+            // O_DIRECT wants aligned offsets and lengths: reread from the last aligned offset
+            size_t from = options.direct ? done / IO_ALIGNMENT * IO_ALIGNMENT : done;
+            auto n = pread(file, b.data + from, options.direct ? align_up(readLength - from) : readLength - from, off_t(readStart + from));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0 || from + size_t(n) <= done)
+                return false;
+            done = from + size_t(n);
+#else
+            stream.seekg(std::streamoff(readStart + done));
+            stream.read(b.data + done, std::streamsize(readLength - done));
+            if (stream.gcount() <= 0)
+                return false;
+            done += size_t(stream.gcount());
+#endif
+        }
+        b.window = std::string_view(b.data, readLength);
+        return true;
+    };
+
+    size_t nextBlock = 0;
+#ifdef CW1_IO_URING
+    if (useRing)
+    {
+        // Keep up to queueDepth reads in flight; results come back in any order
+        std::vector<std::pair<size_t, size_t>> requests(numBuffers);
+        unsigned inFlight = 0;
+        while (!failed && (nextBlock < numBlocks || inFlight > 0))
+        {
+            size_t index;
+            while (nextBlock < numBlocks && inFlight < queueDepth && take_free_buffer(inFlight == 0, index))
+            {
+                size_t readStart, readLength;
+                block_range(nextBlock++, readStart, readLength, blocks[index]);
+                requests[index] = { readStart, readLength };
+                ring.prepare_read(file, blocks[index].data, align_up(readLength), readStart, index);
+                ++inFlight;
+            }
+            if (!ring.submit(1))
+            {
+                failed = true;
+                break;
+            }
+            uint64_t userData;
+            int result;
+            while (ring.pop(userData, result))
+            {
+                --inFlight;
+                auto [readStart, readLength] = requests[userData];
+                // On an error (e.g. a kernel without IORING_OP_READ), the block is read again the blocking way
+                if (!read_rest(userData, result < 0 ? 0 : std::min(size_t(result), readLength), readStart, readLength))
+                    failed = true;
+                else
+                    hand_over(userData);
+            }
+        }
+        // Don't free buffers the kernel may still be writing to
+        while (inFlight > 0 && ring.submit(1))
+        {
+            uint64_t userData;
+            int result;
+            while (ring.pop(userData, result))
+                --inFlight;
+        }
+    }
+#endif
+#ifdef CW1_IO_URING
+    if (!useRing)
+#endif
+    {
+        for (; !failed && nextBlock < numBlocks; ++nextBlock)
+        {
+            size_t index, readStart, readLength;
+            take_free_buffer(true, index);
+            block_range(nextBlock, readStart, readLength, blocks[index]);
+            if (read_rest(index, 0, readStart, readLength))
+                hand_over(index);
+            else
+                failed = true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    filledReady.notify_all();
+    for (auto& t : workers)
+        t.join();
+#ifdef CW1_IO_URING
+    ::close(file);
+#endif
+    if (failed)
+    {
+        std::cerr << "Error: Could not read the file content." << std::endl;
+        return {};
+    }
+
+    std::vector<size_t> counts(words.size(), 0);
+    for (auto& c : workerCounts)
+        for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] += c[i];
+    return counts;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "stream.h"
+
+struct async_read_options
+{
+    // Bytes counted per buffer
+    size_t blockSize = STREAM_BLOCK_SIZE;
+    // Reads kept in flight ahead of the scanners
+    unsigned queueDepth = 4;
+    // Bypass the page cache (O_DIRECT, Linux only): for files read once, or bigger than memory
+    bool direct = false;
+    // Scanning threads (0: one per hardware thread)
+    unsigned numThreads = 0;
+};
+
+// Count the words of the list in a file of any size, with I/O and counting overlapped: on Linux the
+// reads go through io_uring, which keeps queueDepth large reads in flight into a ring of 4 KB aligned
+// buffers, while worker threads count the buffers already filled, in any order. Elsewhere, or if the
+// kernel refuses io_uring, one thread does blocking reads into the same ring instead. A cold-cache
+// file then takes about max(I/O, counting) rather than their sum.
+// Each buffer holds its block plus the bytes around it needed for the boundary tests (one aligned page
+// either side), so blocks are counted independently and the result is exactly that of the whole file
+// in memory. Returns an empty vector on failure.
+std::vector<size_t> count_words_async(const char* filename, const std::vector<std::string_view>& words, const async_read_options& options = {});
@@ -0,0 +1,561 @@
+// Benchmark harness for the cw1 counting strategies. Every strategy counts the same word list in every
+// file of the dataset (and optionally in synthetic multi-GB files), with warm-up runs and repeated
+// trials. It reports the median and p95 time and the throughput (corpus bytes per second of counting
+// the whole list), checks that all the strategies agree, and can write the results as CSV/JSON to
+// track regressions between commits.
+//
+// usage: cw1-bench [options] [dataset folder]
+//     --trials N            timed runs per strategy and file (default 10)
+//     --warmup N            untimed runs first (default 2)
+//     --synthetic GB        also run on a GB-sized file made of copies of the dataset (repeatable)
+//     --strategies a,b,...  only run these strategies (default: all)
+//     --words w1,w2,...     word list (default: the example words of cw1)
+//     --boundaries          instead, check the counters whose work is split into blocks or chunks
+//                           against calc_token_occurrences, with the boundaries at many offsets
+//     --crossover           instead, time the scalar, SIMD, Horspool and Two-Way searches against the
+//                           token length, on each file, a 4-letter random text and two periodic ones
+//                           (with tokens that match at every repetition), and flag the lengths where
+//                           choose_search_algorithm's pick is over 10% slower than the fastest
+//     --csv FILE            write the results as CSV
+//     --json FILE           write the results as JSON
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "aho_corasick.h"
+#include "async_read.h"
+#include "corpus.h"
+#include "dataset.h"
+#include "fm_index.h"
+#include "perfect_hash.h"
+#include "phrase_index.h"
+#include "search.h"
+#include "skip_search.h"
+#include "stream.h"
+#include "suffix_array.h"
+#include "text.h"
+#include "word_index.h"
+#include "words.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono;
+
+// A way of counting every word of the list in a file
+struct strategy
+{
+    std::string name;
+    std::function<std::vector<size_t>(const corpus& text, const std::string& path, const std::vector<std::string_view>& words)> count;
+    // The tokens it can count (unset: all of them). Its counts of the others are ignored, not compared.
+    std::function<bool(std::string_view token)> handles = nullptr;
+    // Untimed work done once per file before the runs, e.g. building the index whose lookups are what's
+    // timed (unset: none). Returns false if the strategy can't run on the file.
+    std::function<bool(const corpus& text, const std::string& path)> prepare = nullptr;
+    // Largest file it runs on
+    size_t maxBytes = SIZE_MAX;
+};
+
+// Indexes take several bytes of memory per corpus byte to build (up to about 19 for the FM-index), so they
+// are skipped on the multi-GB synthetic files
+constexpr size_t INDEX_MAX_BYTES = size_t(256) << 20;
+
+// Timings of one strategy on one file
+struct result
+{
+    std::string file;
+    size_t bytes;
+    std::string strategy;
+    int trials;
+    double medianMs;
+    double p95Ms;
+    double gbps;
+    bool agrees;
+};
+
+std::vector<strategy> all_strategies()
+{
+    std::vector<strategy> strategies;
+    auto per_word = [](auto count) {
+        return [count](const corpus& text, const std::string&, const std::vector<std::string_view>& words) {
+            std::vector<size_t> counts;
+            for (auto word : words)
+                counts.push_back(count(text.view(), std::string(word).c_str()));
+            return counts;
+        };
+    };
+    strategies.push_back({ "scalar", per_word([](std::string_view data, const char* word) { return calc_token_occurrences(data, word); }) });
+    for (auto level : { simd_level::sse2, simd_level::avx2 })
+        if (level <= best_simd_level())
+            strategies.push_back({ simd_level_name(level), per_word([level](std::string_view data, const char* word) { return calc_token_occurrences_simd(data, word, level); }) });
+    strategies.push_back({ "parallel", per_word([](std::string_view data, const char* word) { return calc_token_occurrences_parallel(data, word); }) });
+    for (auto algorithm : { search_algorithm::horspool, search_algorithm::two_way })
+        strategies.push_back({ search_algorithm_name(algorithm), per_word([algorithm](std::string_view data, const char* word) { return calc_token_occurrences_with(data, word, algorithm); }) });
+    strategies.push_back({ "auto", per_word([](std::string_view data, const char* word) { return calc_token_occurrences_auto(data, word); }) });
+    strategies.push_back({ "aho-corasick", [](const corpus& text, const std::string&, const std::vector<std::string_view>& words) {
+        return aho_corasick(words).count(text.view());
+    } });
+    strategies.push_back({ "perfect-hash", [](const corpus& text, const std::string&, const std::vector<std::string_view>& words) {
+        return count_words_batch(text.view(), words);
+    } });
+    strategies.push_back({ "stream", [](const corpus&, const std::string& path, const std::vector<std::string_view>& words) {
+        return count_words_streaming(path.c_str(), words);
+    } });
+    strategies.push_back({ "async", [](const corpus&, const std::string& path, const std::vector<std::string_view>& words) {
+        return count_words_async(path.c_str(), words);
+    } });
+    // Full tokenization of the corpus into a vocabulary, then lookups (what building an index costs).
+    // The vocabulary only has words, so tokens such as "don't" or "to be" are not applicable.
+    strategies.push_back({ "vocabulary", [](const corpus& text, const std::string&, const std::vector<std::string_view>& words) {
+        auto vocabulary = count_words(text.view());
+        std::vector<size_t> counts;
+        for (auto word : words)
+        {
+            auto folded = fold_case(word);
+            auto it = std::lower_bound(vocabulary.begin(), vocabulary.end(), folded, [](const word_count& wc, const std::string& w) { return wc.word < w; });
+            counts.push_back(it != vocabulary.end() && it->word == folded ? size_t(it->count) : 0);
+        }
+        return counts;
+    }, is_word });
+
+    // The indexes are built untimed, so these time the queries alone
+    auto wordIndexPath = (fs::temp_directory_path() / "cw1-bench.cw1idx").string();
+    strategies.push_back({ "word-index", [wordIndexPath](const corpus&, const std::string&, const std::vector<std::string_view>& words) {
+        word_index index;
+        std::vector<size_t> counts;
+        if (!index.open(wordIndexPath.c_str()))
+            return counts;
+        for (auto word : words)
+            counts.push_back(is_word(word) ? size_t(index.count(word)) : 0);
+        return counts;
+    }, is_word, [wordIndexPath](const corpus&, const std::string& path) {
+        return build_word_index(path.c_str(), wordIndexPath.c_str());
+    }, INDEX_MAX_BYTES });
+    auto phrases = std::make_shared<phrase_index>();
+    strategies.push_back({ "phrase-index", [phrases](const corpus&, const std::string&, const std::vector<std::string_view>& words) {
+        std::vector<size_t> counts;
+        for (auto word : words)
+            counts.push_back(phrase_index::is_phrase(word) ? size_t(phrases->count(word)) : 0);
+        return counts;
+    }, phrase_index::is_phrase, [phrases](const corpus& text, const std::string&) {
+        phrases->build(text.view());
+        return true;
+    }, INDEX_MAX_BYTES });
+    auto suffixes = std::make_shared<suffix_array>();
+    strategies.push_back({ "suffix-array", [suffixes](const corpus&, const std::string&, const std::vector<std::string_view>& words) {
+        std::vector<size_t> counts;
+        for (auto word : words)
+            counts.push_back(suffixes->count_token(word));
+        return counts;
+    }, nullptr, [suffixes](const corpus& text, const std::string&) {
+        return suffixes->build(text.view(), 0, false);
+    }, INDEX_MAX_BYTES });
+    auto fm = std::make_shared<fm_index>();
+    strategies.push_back({ "fm-index", [fm](const corpus&, const std::string&, const std::vector<std::string_view>& words) {
+        std::vector<size_t> counts;
+        for (auto word : words)
+            counts.push_back(fm->count_token(word));
+        return counts;
+    }, nullptr, [fm](const corpus& text, const std::string&) {
+        return fm->build(text.view());
+    }, INDEX_MAX_BYTES });
+    return strategies;
+}
+
+// Make (or reuse) a file of about the given size, by repeating the dataset files
+std::string make_synthetic(const std::vector<std::string>& sources, double gigabytes)
+{
+    auto target = uintmax_t(gigabytes * 1e9);
+    auto path = (fs::temp_directory_path() / ("cw1-synthetic-" + std::to_string(target) + ".txt")).string();
+    std::error_code ec;
+    if (fs::file_size(path, ec) >= target && !ec)
+        return path;
+
+    std::cout << "Writing " << path << "..." << std::endl;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    uintmax_t written = 0;
+    while (written < target && !sources.empty())
+        for (auto& source : sources)
+        {
+            corpus text;
+            if (!text.open(source.c_str()))
+                return {};
+            out.write(text.data(), std::streamsize(text.size()));
+            written += text.size();
+        }
+    if (!out)
+    {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return {};
+    }
+    return path;
+}
+
+// Time each search algorithm (on one thread) for tokens of increasing length taken from the text itself,
+// and print which is fastest next to what choose_search_algorithm picks, flagging the lengths where its
+// pick (without SIMD, then with the best SIMD level) is over 10% slower than the fastest it could have
+// picked, which is how its thresholds are checked. On a periodic text, the tokens
+// are trimmed (by less than the period) to end before a non-letter, so they occur at every repetition:
+// the worst case of the SIMD filter and Horspool, which Two-Way is there to bound.
+int run_crossover(const std::string& name, std::string_view text, int numTrials, int& numLosses, bool periodic = false)
+{
+    struct timed
+    {
+        const char* name;
+        std::function<size_t(std::string_view, const char*)> count;
+    };
+    const timed algorithms[] = {
+        { "scalar", [](std::string_view data, const char* token) { return calc_token_occurrences_parallel(data, token, 1, simd_level::scalar); } },
+        { "simd", [](std::string_view data, const char* token) { return calc_token_occurrences_with(data, token, search_algorithm::simd, 1); } },
+        { "horspool", [](std::string_view data, const char* token) { return calc_token_occurrences_with(data, token, search_algorithm::horspool, 1); } },
+        { "two-way", [](std::string_view data, const char* token) { return calc_token_occurrences_with(data, token, search_algorithm::two_way, 1); } },
+    };
+    const int numAlgorithms = 4;
+    // Column of each algorithm the policy can pick, without SIMD and with it
+    auto column = [](search_algorithm algorithm, bool simd) {
+        return algorithm == search_algorithm::two_way ? 3 : algorithm == search_algorithm::horspool ? 2 : simd ? 1 : 0;
+    };
+    const int numTokens = 8;
+    int mismatches = 0;
+    std::cout << name << " (" << text.size() << " bytes)" << std::endl;
+    std::cout << "    length    scalar      simd  horspool   two-way   fastest  chosen (scalar / " << simd_level_name(best_simd_level()) << ")" << std::endl;
+    for (size_t length : { 2, 3, 4, 6, 8, 12, 16, 24, 32, 40, 48, 56, 64, 96, 128 })
+    {
+        if (length * numTokens * 2 >= text.size())
+            break;
+        // Spread over the text, each starting at a word like a query would
+        std::vector<std::string> tokens;
+        for (int t = 0; t < numTokens; ++t)
+        {
+            size_t start = text.size() / numTokens * t + text.size() / (2 * numTokens);
+            for (size_t i = start; i < start + 256 && i + length < text.size(); ++i)
+                if (!is_letter(text[i - 1]) && is_letter(text[i]))
+                {
+                    start = i;
+                    break;
+                }
+            size_t tokenLength = length;
+            while (periodic && tokenLength > 1 && start + tokenLength < text.size() && is_letter(text[start + tokenLength]))
+                --tokenLength;
+            tokens.push_back(std::string(text.substr(start, tokenLength)));
+        }
+        std::vector<size_t> reference;
+        for (auto& token : tokens)
+            reference.push_back(calc_token_occurrences_simd(text, token.c_str()));
+
+        double gbps[numAlgorithms];
+        for (int a = 0; a < numAlgorithms; ++a)
+        {
+            std::vector<double> times;
+            for (int i = 0; i < numTrials; ++i)
+            {
+                std::vector<size_t> counts;
+                auto start = steady_clock::now();
+                for (auto& token : tokens)
+                    counts.push_back(algorithms[a].count(text, token.c_str()));
+                times.push_back(duration<double>(steady_clock::now() - start).count());
+                if (i == 0 && counts != reference)
+                    ++mismatches;
+            }
+            std::sort(times.begin(), times.end());
+            gbps[a] = text.size() * double(numTokens) / times[times.size() / 2] / 1e9;
+        }
+        auto fastest = std::max_element(gbps, gbps + numAlgorithms) - gbps;
+        // The policy is per token, so report its picks for the first one
+        auto chosenScalar = choose_search_algorithm(tokens[0], simd_level::scalar);
+        auto chosenSimd = choose_search_algorithm(tokens[0]);
+        std::cout << "    " << std::setw(6) << tokens[0].size() << std::fixed << std::setprecision(2);
+        for (double g : gbps)
+            std::cout << std::setw(10) << g;
+        std::cout << std::setw(10) << algorithms[fastest].name << "  " << search_algorithm_name(chosenScalar) << " / " << search_algorithm_name(chosenSimd);
+        // Without SIMD the choice is among scalar, Horspool and Two-Way, with it among SIMD, Horspool and Two-Way
+        for (bool simd : { false, true })
+        {
+            double chosen = gbps[column(simd ? chosenSimd : chosenScalar, simd)];
+            double best = std::max({ gbps[simd ? 1 : 0], gbps[2], gbps[3] });
+            if (chosen < 0.9 * best)
+            {
+                std::cout << (simd ? "  SIMD" : "  scalar") << " pick loses (" << chosen << " vs " << best << ")";
+                ++numLosses;
+            }
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+    if (mismatches)
+        std::cerr << "    MISMATCH: the algorithms disagree on " << mismatches << " token lists" << std::endl;
+    return mismatches;
+}
+
+// Check the counters that split their work, with the boundaries at many offsets, against calc_token_occurrences
+// on the whole text. The streaming and async counters read a sample of each file (16 KB from its middle) in
+// blocks of 1 to 64 bytes: the streaming one enlarges them to twice the longest token, and the async one to
+// its 4 KB alignment, so its counts are also checked with 2 to 4 scanning threads taking the blocks in any
+// order. The chunked counters get a text of 8 MB, made of copies of the dataset, and 2 to 8 threads, so
+// each thread has a chunk of its own (chunks are at least PARALLEL_MIN_CHUNK). Returns the number of mismatches.
+int run_boundaries(const std::vector<std::string>& datasetFiles, const std::vector<std::string_view>& words)
+{
+    auto reference = [&](std::string_view data) {
+        std::vector<size_t> counts;
+        for (auto word : words)
+            counts.push_back(calc_token_occurrences(data, std::string(word).c_str()));
+        return counts;
+    };
+    int mismatches = 0;
+    auto check = [&](const std::vector<size_t>& counts, const std::vector<size_t>& expected, const std::string& what) {
+        if (counts == expected)
+            return;
+        std::cerr << "    MISMATCH: " << what << std::endl;
+        ++mismatches;
+    };
+
+    std::string sample;
+    for (auto& file : datasetFiles)
+    {
+        corpus text;
+        if (text.open(file.c_str()))
+            sample += text.view().substr(text.size() / 2, 16 << 10);
+    }
+    auto samplePath = (fs::temp_directory_path() / "cw1-bench-boundaries.txt").string();
+    std::ofstream(samplePath, std::ios::binary | std::ios::trunc) << sample;
+    auto expected = reference(sample);
+    std::cout << "sample (" << sample.size() << " bytes), blocks of 1 to 64 bytes" << std::endl;
+    for (size_t blockSize = 1; blockSize <= 64; ++blockSize)
+    {
+        check(count_words_streaming(samplePath.c_str(), words, blockSize), expected, "stream, block size " + std::to_string(blockSize));
+        async_read_options options;
+        options.blockSize = blockSize;
+        options.numThreads = unsigned(2 + blockSize % 3);
+        check(count_words_async(samplePath.c_str(), words, options), expected, "async, block size " + std::to_string(blockSize));
+    }
+
+    auto path = make_synthetic(datasetFiles, 0.008);
+    corpus text;
+    if (path.empty() || !text.open(path.c_str()))
+        return mismatches + 1;
+    expected = reference(text.view());
+    std::cout << fs::path(path).filename().string() << " (" << text.size() << " bytes), 2 to 8 threads" << std::endl;
+    for (unsigned numThreads = 2; numThreads <= 8; ++numThreads)
+    {
+        auto threads = ", " + std::to_string(numThreads) + " threads";
+        std::vector<size_t> counts;
+        for (auto word : words)
+            counts.push_back(calc_token_occurrences_parallel(text.view(), std::string(word).c_str(), numThreads));
+        check(counts, expected, "parallel" + threads);
+        for (auto algorithm : { search_algorithm::simd, search_algorithm::horspool, search_algorithm::two_way })
+        {
+            counts.clear();
+            for (auto word : words)
+                counts.push_back(calc_token_occurrences_with(text.view(), std::string(word).c_str(), algorithm, numThreads));
+            check(counts, expected, search_algorithm_name(algorithm) + threads);
+        }
+        check(count_words_in_file(path, words, numThreads).occurrences, expected, "dataset (aho-corasick)" + threads);
+        check(count_words_batch(text.view(), words, numThreads), expected, "perfect-hash" + threads);
+    }
+    if (mismatches == 0)
+        std::cout << "    all counts agree" << std::endl;
+    return mismatches;
+}
+
+std::vector<std::string> split(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (size_t comma; (comma = list.find(',', start)) != std::string::npos; start = comma + 1)
+        items.push_back(list.substr(start, comma - start));
+    items.push_back(list.substr(start));
+    return items;
+}
+
+int main(int argc, char** argv)
+{
+    int numTrials = 10;
+    int numWarmup = 2;
+    std::vector<double> synthetic;
+    std::vector<std::string> selected;
+    std::vector<std::string> wordStorage = { "sword", "fire", "death", "love", "hate", "the", "man", "woman" };
+    std::string csvPath, jsonPath;
+    bool crossover = false;
+    bool boundaries = false;
+    const char* folder = "dataset";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--trials" && hasValue)
+            numTrials = std::max(1, atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            numWarmup = std::max(0, atoi(argv[++i]));
+        else if (arg == "--synthetic" && hasValue)
+            synthetic.push_back(atof(argv[++i]));
+        else if (arg == "--strategies" && hasValue)
+            selected = split(argv[++i]);
+        else if (arg == "--words" && hasValue)
+            wordStorage = split(argv[++i]);
+        else if (arg == "--crossover")
+            crossover = true;
+        else if (arg == "--boundaries")
+            boundaries = true;
+        else if (arg == "--csv" && hasValue)
+            csvPath = argv[++i];
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg[0] != '-')
+            folder = argv[i];
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (!fs::is_directory(folder))
+    {
+        std::cerr << "Directory \"" << folder << "\" not found" << std::endl;
+        return -1;
+    }
+    std::vector<std::string_view> words(wordStorage.begin(), wordStorage.end());
+
+    std::vector<std::string> files;
+    for (auto& p : fs::directory_iterator(folder))
+        if (p.path().extension() == ".txt")
+            files.push_back(p.path().string());
+    std::sort(files.begin(), files.end());
+    auto datasetFiles = files;
+    for (auto gb : synthetic)
+    {
+        auto path = make_synthetic(datasetFiles, gb);
+        if (!path.empty())
+            files.push_back(path);
+    }
+
+    if (boundaries)
+        return run_boundaries(datasetFiles, words) == 0 ? 0 : -1;
+
+    if (crossover)
+    {
+        int mismatches = 0;
+        int numLosses = 0;
+        for (auto& file : files)
+        {
+            corpus text;
+            if (text.open(file.c_str()) && !text.empty())
+                mismatches += run_crossover(fs::path(file).filename().string(), text.view(), numTrials, numLosses);
+        }
+        // Small alphabet, where Horspool's shifts are short
+        std::string dna(16 << 20, ' ');
+        std::mt19937 rng(1);
+        for (auto& c : dna)
+            c = "acgt"[rng() % 4];
+        mismatches += run_crossover("acgt (random)", dna, numTrials, numLosses);
+        // Repetitive text, where every position of a periodic token's repetition matches
+        std::string periodic;
+        while (periodic.size() < (16 << 20))
+            periodic += "ha ";
+        mismatches += run_crossover("ha ha ha... (periodic)", periodic, numTrials, numLosses, true);
+        // Period 1, where every token of spaces matches at every position
+        mismatches += run_crossover("spaces (periodic)", std::string(16 << 20, ' '), numTrials, numLosses, true);
+        // Timings are too noisy to fail the run on, unlike disagreeing counts
+        std::cout << "choose_search_algorithm's pick is over 10% slower than the fastest in " << numLosses << " cases" << std::endl;
+        return mismatches == 0 ? 0 : -1;
+    }
+
+    auto strategies = all_strategies();
+    if (!selected.empty())
+        strategies.erase(std::remove_if(strategies.begin(), strategies.end(), [&](const strategy& s) {
+            return std::find(selected.begin(), selected.end(), s.name) == selected.end();
+        }), strategies.end());
+
+    std::vector<result> results;
+    int mismatches = 0;
+    for (auto& file : files)
+    {
+        corpus text;
+        if (!text.open(file.c_str()) || text.empty())
+            continue;
+        std::cout << fs::path(file).filename().string() << " (" << text.size() << " bytes)" << std::endl;
+
+        std::vector<size_t> reference;
+        std::string referenceName;
+        for (auto& s : strategies)
+        {
+            if (text.size() > s.maxBytes)
+            {
+                std::cout << "    " << s.name << ": skipped, the file is over " << (s.maxBytes >> 20) << " MB" << std::endl;
+                continue;
+            }
+            if (s.prepare && !s.prepare(text, file))
+            {
+                std::cerr << "    " << s.name << ": could not prepare" << std::endl;
+                ++mismatches;
+                continue;
+            }
+            std::vector<size_t> counts;
+            for (int i = 0; i < numWarmup; ++i)
+                counts = s.count(text, file, words);
+            std::vector<double> times;
+            for (int i = 0; i < numTrials; ++i)
+            {
+                auto start = steady_clock::now();
+                counts = s.count(text, file, words);
+                times.push_back(duration<double>(steady_clock::now() - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            double median = times[times.size() / 2];
+            double p95 = times[std::min(times.size() - 1, size_t(0.95 * times.size()))];
+
+            // The first strategy run that handles every token is the reference for the others, which are
+            // only compared on the tokens they handle
+            std::string notApplicable;
+            for (auto word : words)
+                if (s.handles && !s.handles(word))
+                    notApplicable += (notApplicable.empty() ? "" : ", ") + std::string(word);
+            if (reference.empty() && notApplicable.empty())
+            {
+                reference = counts;
+                referenceName = s.name;
+            }
+            bool agrees = counts.size() == words.size();
+            for (size_t w = 0; agrees && w < words.size() && !reference.empty(); ++w)
+                if ((!s.handles || s.handles(words[w])) && counts[w] != reference[w])
+                    agrees = false;
+            if (!agrees)
+            {
+                std::cerr << "    MISMATCH: " << s.name << " disagrees with " << referenceName << std::endl;
+                ++mismatches;
+            }
+            results.push_back({ fs::path(file).filename().string(), text.size(), s.name, numTrials, median * 1e3, p95 * 1e3, text.size() / median / 1e9, agrees });
+            auto& r = results.back();
+            std::cout << "    " << r.strategy << ": median " << r.medianMs << " ms, p95 " << r.p95Ms << " ms, " << r.gbps << " GB/s"
+                      << (notApplicable.empty() ? "" : " (not applicable to: " + notApplicable + ")") << std::endl;
+        }
+    }
+
+    if (!csvPath.empty())
+    {
+        std::ofstream csv(csvPath);
+        csv << "file,bytes,strategy,trials,median_ms,p95_ms,gbps,agrees\n";
+        for (auto& r : results)
+            csv << r.file << ',' << r.bytes << ',' << r.strategy << ',' << r.trials << ',' << r.medianMs << ','
+                << r.p95Ms << ',' << r.gbps << ',' << (r.agrees ? "true" : "false") << '\n';
+    }
+    if (!jsonPath.empty())
+    {
+        std::ofstream json(jsonPath);
+        json << "[\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            auto& r = results[i];
+            json << "  {\"file\": \"" << r.file << "\", \"bytes\": " << r.bytes << ", \"strategy\": \"" << r.strategy
+                 << "\", \"trials\": " << r.trials << ", \"median_ms\": " << r.medianMs << ", \"p95_ms\": " << r.p95Ms
+                 << ", \"gbps\": " << r.gbps << ", \"agrees\": " << (r.agrees ? "true" : "false") << "}"
+                 << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        json << "]\n";
+    }
+    return mismatches == 0 ? 0 : -1;
+}
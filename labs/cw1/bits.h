@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit. The argument must be non-zero
+inline int count_trailing_zeros(uint32_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return int(index);
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+inline int count_trailing_zeros(uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return int(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Number of set bits
+inline int count_ones(uint64_t x)
+{
+#ifdef _MSC_VER
+    return int(__popcnt64(x));
+#else
+    return __builtin_popcountll(x);
+#endif
+}
@@ -0,0 +1,134 @@
+#include "corpus.h"
+
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+corpus::corpus(corpus&& other) noexcept
+    : ptr(std::exchange(other.ptr, nullptr))
+    , len(std::exchange(other.len, 0))
+{
+}
+
+corpus& corpus::operator=(corpus&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        ptr = std::exchange(other.ptr, nullptr);
+        len = std::exchange(other.len, 0);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool corpus::open(const char* filename)
+{
+    close();
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Error: Could not open the file " << filename << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        std::cerr << "Error: Could not get the size of the file " << filename << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    // Mapping an empty file fails, but an empty corpus is perfectly valid
+    if (fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    // The view keeps the mapping (and the file) alive, so the handles can go straight away
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping)
+        CloseHandle(mapping);
+    CloseHandle(file);
+    if (!view)
+    {
+        std::cerr << "Error: Could not map the file " << filename << std::endl;
+        return false;
+    }
+    ptr = static_cast<const char*>(view);
+    len = size_t(fileSize.QuadPart);
+    return true;
+}
+
+void corpus::close()
+{
+    if (ptr)
+        UnmapViewOfFile(ptr);
+    ptr = nullptr;
+    len = 0;
+}
+
+#else
+
+bool corpus::open(const char* filename)
+{
+    close();
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Error: Could not open the file " << filename << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        std::cerr << "Error: Could not get the size of the file " << filename << std::endl;
+        ::close(fd);
+        return false;
+    }
+    // mmap() rejects zero-length mappings, but an empty corpus is perfectly valid
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+    void* view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        std::cerr << "Error: Could not map the file " << filename << std::endl;
+        return false;
+    }
+    ptr = static_cast<const char*>(view);
+    len = size_t(st.st_size);
+
+    // Hints only: we read front to back, and large pages cut TLB misses on multi-GB files.
+    // Either can be refused by the kernel/filesystem, which is fine.
+    madvise(view, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(view, len, MADV_HUGEPAGE);
+#endif
+    return true;
+}
+
+void corpus::close()
+{
+    if (ptr)
+        munmap(const_cast<char*>(ptr), len);
+    ptr = nullptr;
+    len = 0;
+}
+
+#endif
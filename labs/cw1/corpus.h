@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Read-only memory mapped view of a text file. Nothing is copied at load time: the bytes stay
+// in the page cache and get paged in as the scanners touch them, so opening is O(1).
+class corpus
+{
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+public:
+    corpus() { }
+    corpus(const corpus&) = delete;
+    corpus& operator=(const corpus&) = delete;
+    corpus(corpus&& other) noexcept;
+    corpus& operator=(corpus&& other) noexcept;
+    ~corpus() { close(); }
+
+    // Map the file. Prints the error and returns false on failure
+    bool open(const char* filename);
+    // Unmap the file, if any
+    void close();
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    std::string_view view() const { return { ptr, len }; }
+};
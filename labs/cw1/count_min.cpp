@@ -0,0 +1,141 @@
+#include "count_min.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+#include "words.h"
+
+count_min_sketch::count_min_sketch(double epsilon, double delta)
+{
+    // w = e / epsilon (rounded up to a power of two, for masking) and d = ln(1 / delta)
+    width = 1;
+    while (double(width) < std::exp(1.0) / epsilon)
+        width *= 2;
+    depth = std::max<size_t>(1, size_t(std::ceil(std::log(1.0 / delta))));
+    // Value-initialized, i.e. zero
+    counters = std::vector<std::atomic<uint64_t>>(width * depth);
+    stripes = std::vector<stripe>(NUM_STRIPES);
+}
+
+uint64_t count_min_sketch::add(std::string_view word)
+{
+    auto h1 = hash_folded(word), h2 = mix_hash(h1) | 1;
+    auto& s = stripes[h1 % NUM_STRIPES];
+    std::lock_guard<std::mutex> guard(s.lock);
+    ++s.words;
+    // Relaxed is enough: the lock orders the adds of this word, and other words' updates of the same
+    // counters only ever raise them
+    uint64_t minimum = UINT64_MAX;
+    for (size_t r = 0; r < depth; ++r)
+        minimum = std::min(minimum, counters[cell(h1, h2, r)].load(std::memory_order_relaxed));
+    // Conservative update: raising the counters above the new estimate would only add error
+    auto estimate = minimum + 1;
+    for (size_t r = 0; r < depth; ++r)
+    {
+        auto& c = counters[cell(h1, h2, r)];
+        auto current = c.load(std::memory_order_relaxed);
+        while (current < estimate && !c.compare_exchange_weak(current, estimate, std::memory_order_relaxed))
+        {
+        }
+    }
+    return estimate;
+}
+
+uint64_t count_min_sketch::estimate(std::string_view word) const
+{
+    auto h1 = hash_folded(word), h2 = mix_hash(h1) | 1;
+    uint64_t minimum = UINT64_MAX;
+    for (size_t r = 0; r < depth; ++r)
+        minimum = std::min(minimum, counters[cell(h1, h2, r)].load(std::memory_order_relaxed));
+    return minimum;
+}
+
+uint64_t count_min_sketch::total_words() const
+{
+    uint64_t total = 0;
+    for (auto& s : stripes)
+        total += s.words;
+    return total;
+}
+
+void heavy_hitters::sift_up(size_t i)
+{
+    auto c = heap[i];
+    while (i > 0 && heap[(i - 1) / 2].estimate > c.estimate)
+    {
+        place(i, heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    place(i, c);
+}
+
+void heavy_hitters::sift_down(size_t i)
+{
+    auto c = heap[i];
+    for (;;)
+    {
+        auto child = 2 * i + 1;
+        if (child >= heap.size())
+            break;
+        if (child + 1 < heap.size() && heap[child + 1].estimate < heap[child].estimate)
+            ++child;
+        if (heap[child].estimate >= c.estimate)
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, c);
+}
+
+void heavy_hitters::update(std::string_view word, uint64_t estimate)
+{
+    if (capacity == 0)
+        return;
+    auto it = positions.find(word);
+    if (it != positions.end())
+    {
+        auto i = it->second;
+        auto old = heap[i].estimate;
+        heap[i].estimate = estimate;
+        if (estimate > old)
+            sift_down(i);
+        else
+            sift_up(i);
+    }
+    else if (heap.size() < capacity)
+    {
+        heap.push_back({ word, estimate });
+        sift_up(heap.size() - 1);
+    }
+    else
+    {
+        // Evict the lightest candidate, at the root, and let the new one sink to its place
+        positions.erase(heap[0].word);
+        place(0, { word, estimate });
+        sift_down(0);
+    }
+    if (heap.size() == capacity)
+        threshold = heap[0].estimate;
+}
+
+approximate_counts count_words_approximate(std::string_view data, const sketch_config& config, unsigned numThreads)
+{
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    count_min_sketch sketch(config.epsilon, config.delta);
+    std::vector<heavy_hitters> heavy(numChunks, heavy_hitters(config.numHeavy));
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& hitters = heavy[chunk];
+        for_each_word(data, begin, end, [&](std::string_view word) { hitters.offer(word, sketch.add(word)); });
+    });
+
+    // A word that's heavy overall is (nearly always) heavy in some chunk too, so the union of the
+    // candidates, re-estimated on the final sketch, gives the overall heavy hitters
+    word_map candidates;
+    for (auto& hitters : heavy)
+        hitters.for_each([&](std::string_view word) {
+            if (candidates.count(word) == 0)
+                candidates.add(word, sketch.estimate(word));
+        });
+    return { std::move(sketch), top_k(candidates, config.numHeavy) };
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.h"
+#include "word_map.h"
+
+// Count-min sketch of word frequencies: depth rows of width counters, each word mapped to one counter
+// per row. A word's estimate (the minimum of its counters) is never below its true count, and with
+// probability 1 - delta it's at most epsilon * (total words) above it. Memory is fixed by epsilon and
+// delta, however large the vocabulary.
+//
+// Updates are conservative: only the counters that equal the current minimum are raised, which
+// keeps the overestimates much smaller. Threads share one sketch: counters are only ever raised, with
+// an atomic max, so a counter shared by two words ends up at least what each needs. Two threads adding
+// the same word at once would both raise its counters to the same new minimum and lose an occurrence,
+// so adds of a word are serialized by a lock picked by its hash, out of a fixed few.
+class count_min_sketch
+{
+private:
+    // Lock of the words with the same hash in its low bits, with the number of words it has let in
+    struct alignas(64) stripe
+    {
+        std::mutex lock;
+        uint64_t words = 0;
+    };
+    static constexpr size_t NUM_STRIPES = 64;
+
+    size_t width = 0;
+    size_t depth = 0;
+    // Row-major, depth x width
+    std::vector<std::atomic<uint64_t>> counters;
+    std::vector<stripe> stripes;
+
+    // Counter of the word in row r (double hashing: row hashes are h1 + r * h2, with h2 odd)
+    size_t cell(uint64_t h1, uint64_t h2, size_t row) const
+    {
+        return row * width + size_t((h1 + row * h2) & (width - 1));
+    }
+public:
+    // epsilon: relative error bound, delta: probability of exceeding it
+    count_min_sketch(double epsilon, double delta);
+
+    // Add an occurrence of a word, returns its new estimate. Any number of threads can add at once.
+    uint64_t add(std::string_view word);
+    uint64_t estimate(std::string_view word) const;
+
+    // Only exact when no thread is adding
+    uint64_t total_words() const;
+    size_t memory_bytes() const { return counters.size() * sizeof(uint64_t) + stripes.size() * sizeof(stripe); }
+    size_t rows() const { return depth; }
+    size_t columns() const { return width; }
+};
+
+// The words with the highest estimates seen so far, at most capacity of them. Keys are views of the corpus.
+// The candidates are kept in a min-heap by estimate, with the position of each word in it, so raising
+// a candidate or evicting the lightest costs O(log capacity) instead of a scan of all of them.
+class heavy_hitters
+{
+private:
+    struct candidate
+    {
+        std::string_view word;
+        uint64_t estimate;
+    };
+    size_t capacity;
+    std::vector<candidate> heap;
+    std::unordered_map<std::string_view, size_t, folded_hash, folded_equal> positions;
+    // Smallest estimate among the candidates, once there are capacity of them
+    uint64_t threshold = 0;
+
+    void place(size_t i, const candidate& c)
+    {
+        heap[i] = c;
+        positions[c.word] = i;
+    }
+    void sift_up(size_t i);
+    void sift_down(size_t i);
+public:
+    explicit heavy_hitters(size_t capacity) : capacity(capacity) { }
+
+    // Offer a word with its latest estimate
+    void offer(std::string_view word, uint64_t estimate)
+    {
+        // Cheap rejection of the vast majority of words: a candidate's estimate only grows, so a word
+        // below the threshold can't be one
+        if (heap.size() == capacity && (estimate <= threshold || capacity == 0))
+            return;
+        update(word, estimate);
+    }
+    void update(std::string_view word, uint64_t estimate);
+
+    // Call f(word) for every candidate
+    template<typename F>
+    void for_each(F&& f) const
+    {
+        for (auto& c : heap)
+            f(c.word);
+    }
+};
+
+struct sketch_config
+{
+    double epsilon = 1e-4;
+    double delta = 0.01;
+    // Number of heavy hitters to track
+    size_t numHeavy = 20;
+};
+
+// Sketch of a whole corpus, with its most frequent words
+struct approximate_counts
+{
+    count_min_sketch sketch;
+    // Estimated counts of the heaviest words, highest first
+    std::vector<word_count> heavy;
+};
+
+// Stream the words of the corpus into one sketch shared by the threads (0 threads: one per hardware
+// thread), each keeping its own heavy hitter candidates, then re-estimate the union of the candidates.
+// Memory is the sketch's, whatever the number of threads, plus numHeavy candidates per thread.
+approximate_counts count_words_approximate(std::string_view data, const sketch_config& config, unsigned numThreads = 0);
@@ -0,0 +1,106 @@
+#include "dataset.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "aho_corasick.h"
+#include "corpus.h"
+#include "parallel.h"
+#include "word_index.h"
+#include "words.h"
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> list_corpus_files(const std::string& path)
+{
+    if (!fs::is_directory(path))
+        return { path };
+    std::vector<std::string> files;
+    for (auto& p : fs::directory_iterator(path))
+        if (p.is_regular_file() && p.path().extension() == ".txt")
+            files.push_back(p.path().string());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<uint64_t> file_sizes(const std::vector<std::string>& paths)
+{
+    std::vector<uint64_t> sizes;
+    for (auto& path : paths)
+    {
+        std::error_code ec;
+        auto size = fs::file_size(path, ec);
+        sizes.push_back(ec ? 0 : uint64_t(size));
+    }
+    return sizes;
+}
+
+file_counts count_words_in_file(const std::string& path, const std::vector<std::string_view>& words, unsigned numThreads)
+{
+    file_counts result;
+    result.path = path;
+    result.occurrences.assign(words.size(), 0);
+
+    // If there's an up-to-date index, words are looked up in it without reading the text. Tokens with
+    // non-letters in them (e.g. "don't") aren't in the index, so they still need a scan.
+    std::vector<size_t> toScan;
+    word_index index;
+    auto indexPath = index_path_for(path);
+    if (fs::exists(indexPath))
+    {
+        // Counting never writes to the dataset: a corrupt or stale index is only reported, and
+        // "cw1 index" rebuilds it
+        bool opened = index.open(indexPath.c_str());
+        result.fromIndex = opened && index.is_fresh_for(path.c_str());
+        result.corruptIndex = !opened;
+        result.staleIndex = opened && !result.fromIndex;
+    }
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        if (result.fromIndex && is_word(words[i]))
+            result.occurrences[i] = index.count(words[i]);
+        else
+            toScan.push_back(i);
+    }
+
+    std::error_code ec;
+    result.size = fs::file_size(path, ec);
+    if (toScan.empty())
+    {
+        result.ok = !ec;
+        return result;
+    }
+
+    // Map the file: no copy and no lowercasing pass, the scan folds case as it goes
+    corpus file_data;
+    if (!file_data.open(path.c_str()))
+        return result;
+    result.size = file_data.size();
+
+    // Count all the words in a single pass, rather than one calc_token_occurrences() scan per word.
+    // Each chunk counts the matches starting in it, reading past its end for the ones that straddle it.
+    std::vector<std::string_view> scanWords;
+    for (auto i : toScan)
+        scanWords.push_back(words[i]);
+    aho_corasick matcher(scanWords);
+    auto data = file_data.view();
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<std::vector<size_t>> counts(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        counts[chunk] = matcher.count(data, begin, end);
+    });
+    for (size_t i = 0; i < toScan.size(); ++i)
+        for (auto& c : counts)
+            result.occurrences[toScan[i]] += c[i];
+    result.ok = true;
+    return result;
+}
+
+std::vector<file_counts> count_words_in_files(const std::vector<std::string>& paths, const std::vector<std::string_view>& words, unsigned numThreads)
+{
+    std::vector<file_counts> results(paths.size());
+    run_largest_first(file_sizes(paths), numThreads, [&](size_t i, unsigned threadsPerFile) {
+        results[i] = count_words_in_file(paths[i], words, threadsPerFile);
+    });
+    return results;
+}
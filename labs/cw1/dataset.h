@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Word counts of one corpus file
+struct file_counts
+{
+    std::string path;
+    uint64_t size = 0;
+    std::vector<size_t> occurrences;
+    // false if the file couldn't be read (the error has been printed)
+    bool ok = false;
+    // The file's index answered the all-letter words
+    bool fromIndex = false;
+    // There is an index, but it's out of date so the file was scanned instead
+    bool staleIndex = false;
+    // There is an index, but it's not a valid one so the file was scanned instead
+    bool corruptIndex = false;
+};
+
+// The corpus files under a path: the .txt files of a directory sorted by name, or the path itself if it's a file
+std::vector<std::string> list_corpus_files(const std::string& path);
+
+// Size of each file, 0 if it can't be read
+std::vector<uint64_t> file_sizes(const std::vector<std::string>& paths);
+
+// Count the words in one file. Words are looked up in the file's index if it's up to date; the rest
+// (or all of them, without an index) are counted in a single Aho-Corasick pass over the mapped file,
+// split in one chunk per thread (0: one per hardware thread).
+file_counts count_words_in_file(const std::string& path, const std::vector<std::string_view>& words, unsigned numThreads = 1);
+
+// Count the words in every file concurrently, on a pool of workers (0: one per hardware thread).
+// Files are handed out largest first, so that the biggest one never starts last and the total time
+// tends towards the time of the largest file. With fewer files than threads, the spare threads split
+// the scans of the files. Results are in the order of the paths given.
+std::vector<file_counts> count_words_in_files(const std::vector<std::string>& paths, const std::vector<std::string_view>& words, unsigned numThreads = 0);
@@ -0,0 +1,232 @@
+#include "fm_index.h"
+
+#include <iostream>
+#include <queue>
+#include <string>
+
+#include "bits.h"
+#include "parallel.h"
+#include "suffix_array.h"
+#include "text.h"
+
+void rank_bits::finish()
+{
+    blockOnes.resize(words.size() / 8 + 1);
+    uint32_t ones = 0;
+    for (size_t w = 0; w < words.size(); ++w)
+    {
+        if (w % 8 == 0)
+            blockOnes[w / 8] = ones;
+        ones += count_ones(words[w]);
+    }
+    if (words.size() % 8 == 0)
+        blockOnes[words.size() / 8] = ones;
+}
+
+size_t rank_bits::rank1(size_t i) const
+{
+    size_t w = i / 64;
+    size_t ones = blockOnes[w / 8];
+    for (size_t b = w & ~size_t(7); b < w; ++b)
+        ones += count_ones(words[b]);
+    if (i % 64)
+        ones += count_ones(words[w] & ((uint64_t(1) << (i % 64)) - 1));
+    return ones;
+}
+
+bool fm_index::build(std::string_view data, unsigned numThreads)
+{
+    nodes.clear();
+    textSize = data.size();
+    suffix_array suffixes;
+    if (!suffixes.build(data, numThreads, false))
+        return false;
+
+    // Dense symbols: 0 is the end marker, which sorts first and occurs once
+    std::vector<size_t> byteCounts(256, 0);
+    for (char c : data)
+        ++byteCounts[uint8_t(fold_case(c))];
+    symbolOf.fill(-1);
+    std::vector<size_t> frequencies = { 1 };
+    for (int b = 0; b < 256; ++b)
+        if (byteCounts[b] > 0)
+        {
+            symbolOf[b] = int(frequencies.size());
+            frequencies.push_back(byteCounts[b]);
+        }
+    int numSymbols = int(frequencies.size());
+    smaller.assign(numSymbols + 1, 0);
+    for (int s = 0; s < numSymbols; ++s)
+        smaller[s + 1] = smaller[s] + frequencies[s];
+
+    // BWT: the character before each sorted suffix. Row 0 is the empty suffix (the end marker's), and
+    // the whole text is preceded by the end marker.
+    const size_t numRows = textSize + 1;
+    std::vector<uint8_t> bwt(numRows);
+    bwt[0] = textSize > 0 ? uint8_t(symbolOf[uint8_t(fold_case(data[textSize - 1]))]) : 0;
+    run_chunks(textSize, num_chunks(textSize, numThreads, PARALLEL_MIN_CHUNK), [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            auto pos = suffixes.position(i);
+            bwt[i + 1] = pos > 0 ? uint8_t(symbolOf[uint8_t(fold_case(data[pos - 1]))]) : 0;
+        }
+    });
+    suffixes = suffix_array();
+
+    // Huffman tree over the symbols. Leaves are numbered -1 - symbol; the frequency of each node is
+    // the number of BWT characters its bit vector will hold.
+    using weighted = std::pair<size_t, int>;
+    std::priority_queue<weighted, std::vector<weighted>, std::greater<weighted>> queue;
+    for (int s = 0; s < numSymbols; ++s)
+        queue.push({ frequencies[s], -1 - s });
+    std::vector<size_t> nodeSizes;
+    std::vector<std::array<int, 2>> children;
+    while (queue.size() > 1)
+    {
+        auto lhs = queue.top();
+        queue.pop();
+        auto rhs = queue.top();
+        queue.pop();
+        children.push_back({ lhs.second, rhs.second });
+        nodeSizes.push_back(lhs.first + rhs.first);
+        queue.push({ lhs.first + rhs.first, int(children.size() - 1) });
+    }
+    // A single symbol (empty text) still gets a one-bit code, under a root of its own
+    if (children.empty())
+    {
+        children.push_back({ -1, -1 });
+        nodeSizes.push_back(numRows);
+    }
+    int root = int(children.size() - 1);
+    for (size_t n = 0; n < children.size(); ++n)
+        nodes.push_back({ rank_bits(nodeSizes[n]), { children[n][0], children[n][1] } });
+
+    // Codes from the root down, then the root stored first so that lookups start at node 0
+    codes.assign(numSymbols, code());
+    std::vector<std::pair<int, code>> stack = { { root, code() } };
+    while (!stack.empty())
+    {
+        auto [n, prefix] = stack.back();
+        stack.pop_back();
+        for (int bit = 0; bit < 2; ++bit)
+        {
+            code child = { (prefix.bits << 1) | uint64_t(bit), prefix.length + 1 };
+            if (nodes[n].children[bit] >= 0)
+                stack.push_back({ nodes[n].children[bit], child });
+            else if (codes[-1 - nodes[n].children[bit]].length == 0)
+                codes[-1 - nodes[n].children[bit]] = child;
+        }
+    }
+    std::swap(nodes[0], nodes[root]);
+    for (auto& n : nodes)
+        for (auto& child : n.children)
+            if (child == 0 || child == root)
+                child = root - child;
+
+    // Distribute the BWT down the tree: each character sets one bit per level of its code
+    std::vector<size_t> filled(nodes.size(), 0);
+    for (auto symbol : bwt)
+    {
+        auto c = codes[symbol];
+        int n = 0;
+        for (int level = c.length - 1; level >= 0; --level)
+        {
+            int bit = int((c.bits >> level) & 1);
+            if (bit)
+                nodes[n].bits.set(filled[n]);
+            ++filled[n];
+            n = nodes[n].children[bit];
+        }
+    }
+    for (auto& n : nodes)
+        n.bits.finish();
+    return true;
+}
+
+size_t fm_index::rank(int symbol, size_t i) const
+{
+    auto c = codes[symbol];
+    int n = 0;
+    for (int level = c.length - 1; level >= 0; --level)
+    {
+        int bit = int((c.bits >> level) & 1);
+        i = bit ? nodes[n].bits.rank1(i) : nodes[n].bits.rank0(i);
+        n = nodes[n].children[bit];
+    }
+    return i;
+}
+
+bool fm_index::extend(char c, size_t& first, size_t& last) const
+{
+    int symbol = symbolOf[uint8_t(fold_case(c))];
+    if (symbol < 0)
+        return false;
+    first = smaller[symbol] + rank(symbol, first);
+    last = smaller[symbol] + rank(symbol, last);
+    return first < last;
+}
+
+void fm_index::find(std::string_view pattern, size_t& first, size_t& last) const
+{
+    first = 0;
+    last = nodes.empty() ? 0 : textSize + 1;
+    for (size_t i = pattern.size(); i-- > 0;)
+        if (!extend(pattern[i], first, last))
+        {
+            first = last = 0;
+            return;
+        }
+}
+
+size_t fm_index::count_substring(std::string_view pattern) const
+{
+    if (pattern.empty())
+        return 0;
+    size_t first, last;
+    find(pattern, first, last);
+    return last - first;
+}
+
+size_t fm_index::count_token(std::string_view token) const
+{
+    if (token.empty())
+        return 0;
+    size_t first, last;
+    find(token, first, last);
+    size_t count = last - first;
+    if (count == 0)
+        return 0;
+    // Occurrences with a letter before, then with a letter after (and, added back, with both)
+    for (char before = 'a'; before <= 'z'; ++before)
+    {
+        size_t f = first, l = last;
+        if (extend(before, f, l))
+            count -= l - f;
+    }
+    std::string extended(token);
+    extended.push_back(' ');
+    for (char after = 'a'; after <= 'z'; ++after)
+    {
+        extended.back() = after;
+        size_t afterFirst, afterLast;
+        find(extended, afterFirst, afterLast);
+        if (afterFirst == afterLast)
+            continue;
+        count -= afterLast - afterFirst;
+        for (char before = 'a'; before <= 'z'; ++before)
+        {
+            size_t f = afterFirst, l = afterLast;
+            if (extend(before, f, l))
+                count += l - f;
+        }
+    }
+    return count;
+}
+
+size_t fm_index::memory_bytes() const
+{
+    size_t bytes = sizeof(*this) + smaller.size() * sizeof(size_t) + codes.size() * sizeof(code);
+    for (auto& n : nodes)
+        bytes += sizeof(node) + n.bits.memory_bytes();
+    return bytes;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Bit vector answering "how many 1s before position i" in constant time, with a running count per
+// 512-bit block (6% on top of the bits)
+class rank_bits
+{
+private:
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> blockOnes;
+    size_t numBits = 0;
+public:
+    explicit rank_bits(size_t size = 0) : words((size + 63) / 64), numBits(size) {}
+
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    // Fill in the block counts, once all the bits are set
+    void finish();
+
+    size_t rank1(size_t i) const;
+    size_t rank0(size_t i) const { return i - rank1(i); }
+    size_t size() const { return numBits; }
+    size_t memory_bytes() const { return words.size() * sizeof(uint64_t) + blockOnes.size() * sizeof(uint32_t); }
+};
+
+// Compressed full-text index of the lowercased corpus: the Burrows-Wheeler transform in a Huffman-shaped
+// wavelet tree, about as many bits per character as the entropy of the text plus the rank overhead, so
+// typically under 5 bits for English. Patterns are counted by backward search, one wavelet tree rank per
+// character, without ever looking at the text again (it can be unmapped after building).
+// Only counting is supported: there are no suffix array samples to locate the matches.
+class fm_index
+{
+private:
+    // Wavelet tree node: bit i tells which child the i-th symbol passing through goes to. A child
+    // index >= 0 is another node, a negative one is -1 - the symbol of a leaf.
+    struct node
+    {
+        rank_bits bits;
+        int children[2];
+    };
+    std::vector<node> nodes;
+    // Huffman code of each symbol, read from the most significant of its length bits
+    struct code
+    {
+        uint64_t bits = 0;
+        int length = 0;
+    };
+    std::vector<code> codes;
+    // Symbols are the distinct folded bytes, densely numbered in byte order after the end marker (symbol 0)
+    std::array<int, 256> symbolOf;
+    // C array: number of characters of the text (and end marker) smaller than each symbol
+    std::vector<size_t> smaller;
+    size_t textSize = 0;
+
+    // Occurrences of the symbol in the first i characters of the BWT
+    size_t rank(int symbol, size_t i) const;
+    // Narrow the range [first, last) of sorted suffixes starting with some string to those starting
+    // with c followed by that string. Returns false if none do.
+    bool extend(char c, size_t& first, size_t& last) const;
+    // Range of sorted suffixes starting with the pattern; empty if there are none
+    void find(std::string_view pattern, size_t& first, size_t& last) const;
+public:
+    // Sort the suffixes (in parallel, with suffix_array), then keep only the BWT. The peak is while they
+    // are sorted: on one thread, about 14 bytes per corpus byte on natural text, up to 19 on very
+    // repetitive text (more with threads, see suffix_array.h); reading the BWT off the suffix array then
+    // takes 5. 0 threads: one per hardware thread. Prints the error and returns false on failure.
+    bool build(std::string_view data, unsigned numThreads = 0);
+
+    // Occurrences of the pattern anywhere, e.g. inside words too
+    size_t count_substring(std::string_view pattern) const;
+
+    // Occurrences not preceded or followed by a letter: same as calc_token_occurrences. Counted as the
+    // pattern's occurrences minus those with a letter before, or after, by inclusion-exclusion on the
+    // 26 (folded) letters, since backward search can only add characters at the front.
+    size_t count_token(std::string_view token) const;
+
+    size_t size() const { return textSize; }
+    size_t memory_bytes() const;
+};
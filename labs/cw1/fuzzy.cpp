@@ -0,0 +1,76 @@
+#include "fuzzy.h"
+
+#include <cstdlib>
+
+#include "parallel.h"
+#include "text.h"
+#include "words.h"
+
+fuzzy_matcher::fuzzy_matcher(std::string_view token)
+    : length(token.size())
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        auto c = uint8_t(fold_case(token[i]));
+        peq[c] |= uint64_t(1) << i;
+        // Upper case corpus bytes must match too
+        if (c >= 'a' && c <= 'z')
+            peq[c & ~0x20] |= uint64_t(1) << i;
+    }
+}
+
+int fuzzy_matcher::distance(std::string_view word, int maxDistance) const
+{
+    // The length difference alone costs that many insertions/deletions
+    if (std::abs(int(word.size()) - int(length)) > maxDistance)
+        return maxDistance + 1;
+
+    // Column-wise vertical deltas of the DP matrix as bit vectors (Pv: +1, Mv: -1). The score tracks
+    // the last row, i.e. the distance between the whole token and the word so far.
+    const uint64_t high = uint64_t(1) << (length - 1);
+    uint64_t pv = length == 64 ? ~uint64_t(0) : (high << 1) - 1;
+    uint64_t mv = 0;
+    int score = int(length);
+    for (size_t j = 0; j < word.size(); ++j)
+    {
+        uint64_t eq = peq[uint8_t(word[j])];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & high)
+            ++score;
+        else if (mh & high)
+            --score;
+        // The first row is the cost of skipping word characters, so it grows by one per column
+        // (a search over all starting positions would shift in a 0 instead)
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        // Each remaining character can lower the score by one at most
+        if (score - int(word.size() - j - 1) > maxDistance)
+            return maxDistance + 1;
+    }
+    return score;
+}
+
+word_map find_fuzzy_occurrences(std::string_view data, std::string_view token, int maxDistance, unsigned numThreads)
+{
+    if (!is_word(token) || token.size() > FUZZY_MAX_LENGTH || maxDistance < 0)
+        return word_map();
+    fuzzy_matcher matcher(token);
+
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<word_map> maps(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& map = maps[chunk];
+        for_each_word(data, begin, end, [&](std::string_view word) {
+            if (matcher.distance(word, maxDistance) <= maxDistance)
+                map.add(word);
+        });
+    });
+    for (unsigned i = 1; i < numChunks; ++i)
+        maps[0].merge(maps[i]);
+    return std::move(maps[0]);
+}
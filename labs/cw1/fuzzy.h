@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "word_map.h"
+
+// Maximum token length of the fuzzy matcher: one bit per token character in a 64-bit word
+constexpr size_t FUZZY_MAX_LENGTH = 64;
+
+// Bit-parallel edit distance (Myers' algorithm, in Hyyro's formulation) between a fixed token and
+// words, ignoring case. Each word character costs a handful of 64-bit operations, whatever the token
+// length (up to FUZZY_MAX_LENGTH).
+class fuzzy_matcher
+{
+private:
+    // For every byte, the bit mask of the token positions holding it
+    uint64_t peq[256] = {};
+    size_t length = 0;
+public:
+    // The token must be 1 to FUZZY_MAX_LENGTH characters long
+    explicit fuzzy_matcher(std::string_view token);
+
+    // Levenshtein distance between the token and the word, or any value above maxDistance
+    // if it's known to be larger (the computation stops early)
+    int distance(std::string_view word, int maxDistance) const;
+};
+
+// Find the words of the corpus (maximal runs of letters, so the letter-boundary rules of
+// calc_token_occurrences hold) within edit distance maxDistance of the token, in parallel (0 threads:
+// one per hardware thread). Returns each matching spelling with its count; with maxDistance 0 the
+// total is the exact count. The token must consist of letters only, and be at most FUZZY_MAX_LENGTH long.
+word_map find_fuzzy_occurrences(std::string_view data, std::string_view token, int maxDistance, unsigned numThreads = 0);
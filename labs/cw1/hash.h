@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "text.h"
+
+// 64-bit FNV-1a over the case folded bytes, so "The" and "the" hash the same. Meant for words.
+inline uint64_t hash_folded(std::string_view s)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (char c : s)
+        h = (h ^ uint8_t(fold_case(c))) * 1099511628211ull;
+    return h;
+}
+
+// Final avalanche step of MurmurHash3, spreads every input bit over the whole output
+inline uint64_t mix_hash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Hash of a large buffer, 8 bytes at a time. Not cryptographic: it's only used to notice that a file changed.
+inline uint64_t hash_bytes(const char* data, size_t size, uint64_t seed = 0)
+{
+    uint64_t h = mix_hash(seed ^ size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        h = (h ^ mix_hash(v)) * 0x9e3779b97f4a7c15ull;
+    }
+    for (; i < size; ++i)
+        h = (h ^ uint8_t(data[i])) * 0x100000001b3ull;
+    return mix_hash(h);
+}
+
+// Hash/equality functors for containers keyed by corpus words, which are views of the original (mixed case) text
+struct folded_hash
+{
+    size_t operator()(std::string_view s) const { return size_t(hash_folded(s)); }
+};
+
+struct folded_equal
+{
+    bool operator()(std::string_view a, std::string_view b) const
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (fold_case(a[i]) != fold_case(b[i]))
+                return false;
+        return true;
+    }
+};
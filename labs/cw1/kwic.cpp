@@ -0,0 +1,138 @@
+#include "kwic.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "bits.h"
+#include "parallel.h"
+#include "search.h"
+#include "simd.h"
+
+// Append the offset after each '\n' in [begin, end)
+static void find_line_starts_scalar(std::string_view data, size_t begin, size_t end, std::vector<size_t>& starts)
+{
+    for (size_t i = begin; i < end; ++i)
+        if (data[i] == '\n')
+            starts.push_back(i + 1);
+}
+
+#ifdef CW1_X86
+
+static void find_line_starts_sse2(std::string_view data, size_t begin, size_t end, std::vector<size_t>& starts)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        uint32_t mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data.data() + i)), newline)));
+        while (mask)
+        {
+            starts.push_back(i + count_trailing_zeros(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+    find_line_starts_scalar(data, i, end, starts);
+}
+
+CW1_TARGET_AVX2 static void find_line_starts_avx2(std::string_view data, size_t begin, size_t end, std::vector<size_t>& starts)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = begin;
+    for (; i + 32 <= end; i += 32)
+    {
+        uint32_t mask = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data.data() + i)), newline)));
+        while (mask)
+        {
+            starts.push_back(i + count_trailing_zeros(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+    find_line_starts_scalar(data, i, end, starts);
+}
+
+#endif
+
+static void find_line_starts(std::string_view data, size_t begin, size_t end, std::vector<size_t>& starts)
+{
+    switch (best_simd_level())
+    {
+#ifdef CW1_X86
+    case simd_level::avx2: return find_line_starts_avx2(data, begin, end, starts);
+    case simd_level::sse2: return find_line_starts_sse2(data, begin, end, starts);
+#endif
+    default: return find_line_starts_scalar(data, begin, end, starts);
+    }
+}
+
+line_index::line_index(std::string_view data, unsigned numThreads) : text(data)
+{
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<std::vector<size_t>> chunkStarts(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        find_line_starts(data, begin, end, chunkStarts[chunk]);
+    });
+    // A final newline doesn't start another line
+    starts.push_back(0);
+    for (auto& s : chunkStarts)
+        starts.insert(starts.end(), s.begin(), s.end());
+    if (starts.size() > 1 && starts.back() == data.size())
+        starts.pop_back();
+}
+
+size_t line_index::line_of(size_t offset) const
+{
+    return size_t(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+}
+
+std::string_view line_index::line(size_t line) const
+{
+    size_t begin = starts[line];
+    size_t end = line + 1 < starts.size() ? starts[line + 1] - 1 : text.size();
+    if (end > begin && text[end - 1] == '\r')
+        --end;
+    return text.substr(begin, end - begin);
+}
+
+// Context characters on one line, for display
+static std::string flatten(std::string_view context)
+{
+    std::string flat(context);
+    for (auto& c : flat)
+        if (c == '\n' || c == '\r' || c == '\t')
+            c = ' ';
+    return flat;
+}
+
+std::vector<context_match> find_in_context(std::string_view data, const line_index& lines, const char* token, const context_options& options)
+{
+    std::vector<context_match> matches;
+    size_t tokenLen = strlen(token);
+    for (auto offset : find_token_occurrences(data, token))
+    {
+        if (matches.size() >= options.maxMatches)
+            break;
+        context_match m;
+        m.offset = offset;
+        auto line = lines.line_of(offset);
+        m.line = line + 1;
+        m.column = offset - lines.line_start(line) + 1;
+        m.match = data.substr(offset, tokenLen);
+        if (options.contextLines == 0)
+        {
+            size_t before = std::min(offset, options.contextChars);
+            m.before = flatten(data.substr(offset - before, before));
+            m.after = flatten(data.substr(offset + tokenLen, options.contextChars));
+        }
+        else
+        {
+            m.firstLine = line > options.contextLines ? line - options.contextLines : 0;
+            size_t lastLine = std::min(lines.num_lines() - 1, line + options.contextLines);
+            for (size_t l = m.firstLine; l <= lastLine; ++l)
+                m.lines.push_back(lines.line(l));
+            ++m.firstLine;
+        }
+        matches.push_back(std::move(m));
+    }
+    return matches;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Start offset of every line of the corpus, found once with a SIMD scan for '\n' split over the threads,
+// so that the line of any offset is a binary search away instead of a scan back to the previous newline.
+// Lines end at '\n'; a "\r\n" ending is left out of the line's text too.
+class line_index
+{
+private:
+    std::string_view text;
+    std::vector<size_t> starts;
+public:
+    line_index() = default;
+    // 0 threads: one per hardware thread
+    explicit line_index(std::string_view data, unsigned numThreads = 0);
+
+    size_t num_lines() const { return starts.size(); }
+    // Line (from 0) holding the byte at the offset
+    size_t line_of(size_t offset) const;
+    size_t line_start(size_t line) const { return starts[line]; }
+    // Text of the line, without its line ending
+    std::string_view line(size_t line) const;
+};
+
+// One match with what surrounds it
+struct context_match
+{
+    size_t offset;
+    // Line (from 1) and column (from 1) of the match
+    size_t line;
+    size_t column;
+    // Context in characters: up to N bytes either side, on one line (line breaks and tabs shown as spaces)
+    std::string before;
+    std::string_view match;
+    std::string after;
+    // Context in lines: the match's line and N lines either side (empty if context is in characters)
+    size_t firstLine = 0;
+    std::vector<std::string_view> lines;
+};
+
+struct context_options
+{
+    // Bytes of context either side of the match, when contextLines is 0
+    size_t contextChars = 40;
+    // Lines of context either side of the match's line; 0 for character context
+    size_t contextLines = 0;
+    // Stop after this many matches
+    size_t maxMatches = SIZE_MAX;
+};
+
+// Keyword in context: the whole-word matches of the token (same rules as calc_token_occurrences)
+// with their line, column and context
+std::vector<context_match> find_in_context(std::string_view data, const line_index& lines, const char* token, const context_options& options = {});
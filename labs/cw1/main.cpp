@@ -1,89 +1,619 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
-#include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
-#include <algorithm>
 
-std::vector<char> read_file(const char* filename)
+#include "async_read.h"
+#include "corpus.h"
+#include "count_min.h"
+#include "dataset.h"
+#include "fm_index.h"
+#include "fuzzy.h"
+#include "kwic.h"
+#include "perfect_hash.h"
+#include "phrase_index.h"
+#include "search.h"
+#include "server.h"
+#include "vocabulary.h"
+#include "word_map.h"
+#include "words.h"
+#include "stream.h"
+#include "suffix_array.h"
+#include "tfidf.h"
+#include "word_index.h"
+
+// Build the word index of each file given
+int build_indices(int numFiles, char** files)
 {
-    // Open the file in binary mode
-    std::ifstream file(filename, std::ios::binary);
+    int result = 0;
+    for (int i = 0; i < numFiles; ++i)
+        if (!build_word_index(files[i], index_path_for(files[i]).c_str()))
+            result = -1;
+    return result;
+}
 
-    // Check if the file opened successfully
-    if (!file) {
-        std::cerr << "Error: Could not open the file " << filename << std::endl;
-        return {};
+// Parse the value of a numeric option: digits only (no sign, no trailing text), at most maxValue.
+// Prints the error and returns false otherwise, or if the value is missing (null).
+bool parse_count(const char* option, const char* arg, size_t maxValue, size_t& value)
+{
+    char* numberEnd = nullptr;
+    unsigned long long number = 0;
+    if (arg && arg[0] >= '0' && arg[0] <= '9')
+    {
+        errno = 0;
+        number = strtoull(arg, &numberEnd, 10);
+        if (errno == ERANGE)
+            numberEnd = nullptr;
+    }
+    if (!numberEnd || *numberEnd != '\0' || number > maxValue)
+    {
+        std::cerr << "Error: " << option << " expects a number";
+        if (maxValue < SIZE_MAX)
+            std::cerr << " up to " << maxValue;
+        std::cerr << std::endl;
+        return false;
     }
+    value = size_t(number);
+    return true;
+}
 
-    // Move the file cursor to the end of the file to get its size
-    file.seekg(0, std::ios::end);
-    std::streamsize fileSize = file.tellg();
+// Example word list, unless words are given on the command line
+std::vector<std::string_view> word_list(int numWords, char** argWords)
+{
+    if (numWords > 0)
+        return { argWords, argWords + numWords };
+    return {"sword", "fire", "death", "love", "hate", "the", "man", "woman"};
+}
 
-    // Return the file cursor to the beginning of the file
-    file.seekg(0, std::ios::beg);
+void print_occurrences(const std::vector<std::string_view>& words, const std::vector<size_t>& occurrences)
+{
+    for (size_t i = 0; i < words.size(); ++i)
+        std::cout << "    Found "<< occurrences[i] << " occurrences of word: " << words[i] << std::endl;
+}
 
-    // Create a vector of the same size as the file to hold the content
-    std::vector<char> buffer(fileSize);
+// Count the words in a file of any size, with a few MB of memory
+int stream_count(const char* filepath, const std::vector<std::string_view>& words)
+{
+    auto occurrences = count_words_streaming(filepath, words);
+    if (occurrences.empty() && !words.empty())
+        return -1;
+    print_occurrences(words, occurrences);
+    return 0;
+}
 
-    // Read the entire file into the vector
-    if (!file.read(buffer.data(), fileSize)) {
-        std::cerr << "Error: Could not read the file content." << std::endl;
-        return {};
+// Same, with reads kept in flight (io_uring on Linux) while worker threads count the blocks already read
+int async_count(const char* filepath, bool direct, const std::vector<std::string_view>& words)
+{
+    async_read_options options;
+    options.direct = direct;
+    auto start = std::chrono::steady_clock::now();
+    auto occurrences = count_words_async(filepath, words, options);
+    if (occurrences.empty() && !words.empty())
+        return -1;
+    print_occurrences(words, occurrences);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Counted in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+    return 0;
+}
+
+// Count phrases (or words) in each file with a positional index
+int count_phrases(const char* path, int numPhrases, char** phrases)
+{
+    int result = 0;
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+        {
+            result = -1;
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        phrase_index index;
+        index.build(text.view());
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << file << " (" << text.size() << " bytes, " << index.num_words() << " distinct words, "
+                  << index.postings_size() << " bytes of postings, built in " << elapsed * 1e3 << " ms)" << std::endl;
+        for (int i = 0; i < numPhrases; ++i)
+        {
+            if (phrase_index::is_phrase(phrases[i]))
+                std::cout << "    Found " << index.count(phrases[i]) << " occurrences of phrase: " << phrases[i] << std::endl;
+            else
+                std::cout << "    Not a phrase (must start and end with a letter): " << phrases[i] << std::endl;
+        }
+    }
+    return result;
+}
+
+void print_top(const std::vector<word_count>& top)
+{
+    for (size_t i = 0; i < top.size(); ++i)
+        std::cout << "    " << i + 1 << ". " << top[i].word << ": " << top[i].count << std::endl;
+}
+
+// The k most frequent words of each file, and of all of them together
+int top_words(const char* path, size_t k)
+{
+    auto files = list_corpus_files(path);
+    // The maps' keys point into the corpora, so they all stay mapped until the end
+    std::vector<corpus> texts(files.size());
+    word_map all;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (!texts[i].open(files[i].c_str()))
+            return -1;
+        auto map = count_word_map(texts[i].view());
+        std::cout << files[i] << " (" << texts[i].size() << " bytes, " << map.size() << " distinct words)" << std::endl;
+        print_top(top_k(map, k));
+        all.merge(map);
     }
+    if (files.size() > 1)
+    {
+        std::cout << "All " << files.size() << " files (" << all.size() << " distinct words)" << std::endl;
+        print_top(top_k(all, k));
+    }
+    return 0;
+}
 
-    // Close the file
-    file.close();
+// Approximate counts with a count-min sketch, in bounded memory whatever the vocabulary. Options
+// --epsilon, --delta and --top set up the sketch, and --check also runs the exact counter to compare.
+int approximate_count(const char* path, int argc, char** argv)
+{
+    sketch_config config;
+    bool check = false;
+    std::vector<std::string_view> words;
+    for (int i = 0; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--epsilon" && i + 1 < argc)
+            config.epsilon = atof(argv[++i]);
+        else if (arg == "--delta" && i + 1 < argc)
+            config.delta = atof(argv[++i]);
+        else if (arg == "--top")
+        {
+            if (!parse_count("--top", i + 1 < argc ? argv[++i] : nullptr, SIZE_MAX, config.numHeavy))
+                return -1;
+        }
+        else if (arg == "--check")
+            check = true;
+        else
+            words.push_back(arg);
+    }
+    if (config.epsilon <= 0 || config.delta <= 0 || config.delta >= 1)
+    {
+        std::cerr << "Error: epsilon must be > 0 and delta in (0, 1)" << std::endl;
+        return -1;
+    }
+    if (words.empty())
+        words = word_list(0, nullptr);
 
-    // Output the number of bytes read
-    std::cout << "Successfully read " << buffer.size() << " bytes from the file." << std::endl;
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        auto counts = count_words_approximate(text.view(), config);
+        auto& sketch = counts.sketch;
+        std::cout << file << " (" << sketch.total_words() << " words, " << sketch.rows() << "x" << sketch.columns()
+                  << " sketch, " << sketch.memory_bytes() << " bytes, error <= " << uint64_t(config.epsilon * sketch.total_words())
+                  << " with probability " << 1 - config.delta << ")" << std::endl;
+        for (auto word : words)
+        {
+            // The sketch only knows words; anything else needs the exact counter
+            if (!is_word(word))
+            {
+                std::cout << "    Not a word (letters only): " << word << std::endl;
+                continue;
+            }
+            std::cout << "    ~" << sketch.estimate(word) << " occurrences of word: " << word;
+            if (check)
+                std::cout << " (exact: " << calc_token_occurrences_parallel(text.view(), std::string(word).c_str()) << ")";
+            std::cout << std::endl;
+        }
+        std::cout << "    Heavy hitters:" << std::endl;
+        print_top(counts.heavy);
+    }
+    return 0;
+}
 
-    // convert to lowercase
-    std::transform(buffer.begin(), buffer.end(), buffer.begin(), [](char c) { return std::tolower(c); });
+// Count the words within edit distance k of each token, with the most common spellings found
+int fuzzy_count(const char* path, int maxDistance, const std::vector<std::string_view>& words)
+{
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        std::cout << file << " (" << text.size() << " bytes)" << std::endl;
+        for (auto word : words)
+        {
+            if (!is_word(word) || word.size() > FUZZY_MAX_LENGTH)
+            {
+                std::cout << "    Not a word of at most " << FUZZY_MAX_LENGTH << " letters: " << word << std::endl;
+                continue;
+            }
+            auto matches = find_fuzzy_occurrences(text.view(), word, maxDistance);
+            uint64_t total = 0;
+            matches.for_each([&](std::string_view, uint64_t n) { total += n; });
+            std::cout << "    Found " << total << " occurrences within distance " << maxDistance << " of word: " << word << std::endl;
+            for (auto& spelling : top_k(matches, 5))
+                std::cout << "        " << spelling.word << ": " << spelling.count << std::endl;
+        }
+    }
+    return 0;
+}
 
-    return buffer;
+// Count the words matching prefix/wildcard patterns such as "lov*" or "wom?n", from the file's index
+// if it's up to date, or else from a vocabulary built with a single pass over the text
+int match_patterns(const char* path, int numPatterns, char** patterns)
+{
+    for (auto& file : list_corpus_files(path))
+    {
+        word_index index;
+        auto indexPath = index_path_for(file);
+        bool useIndex = std::filesystem::exists(indexPath) && index.open(indexPath.c_str()) && index.is_fresh_for(file.c_str());
+        vocabulary vocab;
+        if (!useIndex)
+        {
+            corpus text;
+            if (!text.open(file.c_str()))
+                return -1;
+            vocab = vocabulary(text.view());
+        }
+        std::cout << file << (useIndex ? " (from index)" : "") << std::endl;
+        for (int i = 0; i < numPatterns; ++i)
+        {
+            std::vector<word_count> matches;
+            auto total = useIndex ? count_matching(index, patterns[i], &matches) : count_matching(vocab, patterns[i], &matches);
+            std::cout << "    Found " << total << " occurrences of " << matches.size() << " words matching: " << patterns[i] << std::endl;
+            std::sort(matches.begin(), matches.end(), [](const word_count& lhs, const word_count& rhs) { return lhs.count > rhs.count; });
+            for (size_t m = 0; m < matches.size() && m < 10; ++m)
+                std::cout << "        " << matches[m].word << ": " << matches[m].count << std::endl;
+        }
+    }
+    return 0;
 }
 
-int calc_token_occurrences(const std::vector<char>& data, const char* token)
+// Count arbitrary substrings (inside words too) with a suffix array of each file, next to the whole-token counts
+int count_substrings(const char* path, int numPatterns, char** patterns)
 {
-    int numOccurrences = 0;
-    int tokenLen = int(strlen(token));
-    for (int i = 0; i< int(data.size()); ++i)
+    for (auto& file : list_corpus_files(path))
     {
-        // test 1: does this match the token?
-        auto diff = strncmp(&data[i], token, tokenLen);
-        if (diff != 0)
-            continue;
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        auto start = std::chrono::steady_clock::now();
+        suffix_array suffixes;
+        if (!suffixes.build(text.view()))
+            return -1;
+        auto end = std::chrono::steady_clock::now();
+        std::cout << file << ": suffix array built in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms ("
+                  << suffixes.memory_bytes() / (1 << 20) << " MB, longest repeat: " << suffixes.longest_repeat() << " chars)" << std::endl;
+        for (int i = 0; i < numPatterns; ++i)
+            std::cout << "    Found " << suffixes.count_substring(patterns[i]) << " occurrences (" << suffixes.count_token(patterns[i])
+                      << " as a token) of: " << patterns[i] << std::endl;
+    }
+    return 0;
+}
 
-        // test 2: is the prefix a non-letter character?
-        auto iPrefix = i - 1;
-        if (iPrefix >= 0 && data[iPrefix] >= 'a' && data[iPrefix] <= 'z')
-            continue;
+// Same counts from a compressed FM-index, built per file and reported with its size against the text's
+int count_substrings_compressed(const char* path, int numPatterns, char** patterns)
+{
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        auto start = std::chrono::steady_clock::now();
+        fm_index index;
+        if (!index.build(text.view()))
+            return -1;
+        auto end = std::chrono::steady_clock::now();
+        std::cout << file << ": FM-index built in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms ("
+                  << index.memory_bytes() / 1024 << " KB, " << (text.size() ? 100.0 * index.memory_bytes() / text.size() : 0) << "% of the text)" << std::endl;
+        text.close();
+        for (int i = 0; i < numPatterns; ++i)
+            std::cout << "    Found " << index.count_substring(patterns[i]) << " occurrences (" << index.count_token(patterns[i])
+                      << " as a token) of: " << patterns[i] << std::endl;
+    }
+    return 0;
+}
 
-        // test 3: is the prefix a non-letter character?
-        auto iSuffix = i + tokenLen;
-        if (iSuffix < int(data.size()) && data[iSuffix] >= 'a' && data[iSuffix] <= 'z')
-            continue;
-        ++numOccurrences;
+// Show each match of the token with its line, column and the text around it: N characters either side,
+// aligned on the match, or N whole lines
+int show_in_context(const char* path, const char* token, int numOptions, char** options)
+{
+    context_options contextOptions;
+    contextOptions.maxMatches = 20;
+    for (int i = 0; i < numOptions; i += 2)
+    {
+        size_t* value = nullptr;
+        size_t maxValue = SIZE_MAX;
+        if (strcmp(options[i], "--chars") == 0)
+        {
+            value = &contextOptions.contextChars;
+            // The matches are printed aligned, each padded to this width
+            maxValue = 1000;
+        }
+        else if (strcmp(options[i], "--lines") == 0)
+            value = &contextOptions.contextLines;
+        else if (strcmp(options[i], "--max") == 0)
+            value = &contextOptions.maxMatches;
+        else
+        {
+            std::cerr << "Error: Unknown option " << options[i] << std::endl;
+            return -1;
+        }
+        if (!parse_count(options[i], i + 1 < numOptions ? options[i + 1] : nullptr, maxValue, *value))
+            return -1;
+    }
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        line_index lines(text.view());
+        for (auto& m : find_in_context(text.view(), lines, token, contextOptions))
+        {
+            if (contextOptions.contextLines == 0)
+            {
+                std::cout << file << ':' << m.line << ':' << m.column << ": " << std::setw(int(contextOptions.contextChars))
+                          << m.before << '[' << m.match << ']' << m.after << std::endl;
+                continue;
+            }
+            std::cout << file << ':' << m.line << ':' << m.column << std::endl;
+            for (size_t l = 0; l < m.lines.size(); ++l)
+                std::cout << (m.firstLine + l == m.line ? "  > " : "    ") << m.firstLine + l << "  " << m.lines[l] << std::endl;
+        }
     }
-    return numOccurrences;
+    return 0;
 }
 
-int main()
+// Rank the words of each file by tf-idf against the other files, and list the k best
+int top_tfidf(const char* path, size_t k)
 {
-    // Example chosen file
-    const char * filepath = "dataset/shakespeare.txt";
+    auto start = std::chrono::steady_clock::now();
+    // idf compares a document with the others: with no others, every term would score 0
+    auto files = list_corpus_files(path);
+    if (files.size() < 2)
+    {
+        std::cerr << "Error: tf-idf needs a folder of at least 2 documents, \"" << path << "\" has " << files.size() << std::endl;
+        return -1;
+    }
+    term_doc_table table;
+    if (!table.build(files))
+        return -1;
+    auto end = std::chrono::steady_clock::now();
+    std::cout << table.num_documents() << " documents, " << table.num_terms() << " terms, tabulated in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+    for (size_t d = 0; d < table.num_documents(); ++d)
+    {
+        std::cout << table.document(d) << " (" << table.document_words(d) << " words, " << table.document_terms(d) << " distinct)" << std::endl;
+        for (auto& t : table.top_terms(d, k))
+            std::cout << "    " << t.term << ": " << t.score << " (" << t.count << " occurrences)" << std::endl;
+    }
+    return 0;
+}
 
-    std::vector<char> file_data = read_file(filepath);
-    if (file_data.empty())
+// Chart the occurrences of a token per N-byte window, or per section if a heading such as "CHAPTER" is given
+int token_histogram(const char* path, const char* token, const char* segmentArg)
+{
+    segmentation segments;
+    char* numberEnd;
+    auto windowSize = strtoull(segmentArg, &numberEnd, 10);
+    if (*numberEnd == '\0' && windowSize == 0)
+    {
+        std::cerr << "Error: Expected a window size of at least 1 byte, or a heading" << std::endl;
         return -1;
+    }
+    if (*numberEnd == '\0')
+        segments.windowSize = size_t(windowSize);
+    else
+        segments.delimiter = segmentArg;
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        auto bins = calc_token_histogram(text.view(), token, segments);
+        size_t maxCount = 1;
+        for (auto& bin : bins)
+            maxCount = std::max(maxCount, bin.count);
+        std::cout << file << ": " << bins.size() << (segments.windowSize ? " windows" : " sections") << std::endl;
+        for (auto& bin : bins)
+        {
+            // Sections are labelled with their heading line, windows with their offset
+            std::string label = std::to_string(bin.begin);
+            if (!segments.windowSize)
+            {
+                auto heading = text.view().substr(bin.begin, std::min<size_t>(bin.end - bin.begin, 24));
+                label = std::string(heading.substr(0, std::min(heading.size(), heading.find_first_of("\r\n"))));
+            }
+            std::cout << "    " << label << std::string(label.size() < 24 ? 24 - label.size() : 0, ' ') << ' ' << std::string(50 * bin.count / maxCount, '#')
+                      << ' ' << bin.count << std::endl;
+        }
+    }
+    return 0;
+}
 
-    // Example word list
-    const char * words[] = {"sword", "fire", "death", "love", "hate", "the", "man", "woman"};
-    for(const char * word : words)
+// Count a long list of words (one per line in a file) in each file, with one tokenization pass per file
+int batch_count(const char* path, const char* listPath)
+{
+    std::ifstream listFile(listPath);
+    if (!listFile)
+    {
+        std::cerr << "Error: Could not open word list " << listPath << std::endl;
+        return -1;
+    }
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(listFile, line);)
     {
-        int occurrences = calc_token_occurrences(file_data, word);
-        std::cout << "Found "<< occurrences << " occurrences of word: " << word << std::endl;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty())
+            lines.push_back(std::move(line));
     }
+    std::vector<std::string_view> words(lines.begin(), lines.end());
 
+    for (auto& file : list_corpus_files(path))
+    {
+        corpus text;
+        if (!text.open(file.c_str()))
+            return -1;
+        auto start = std::chrono::steady_clock::now();
+        auto occurrences = count_words_batch(text.view(), words);
+        auto end = std::chrono::steady_clock::now();
+        std::cout << file << " (" << words.size() << " words, counted in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms)" << std::endl;
+        print_occurrences(words, occurrences);
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+// Load the corpora once and answer queries from stdin, or from a Unix domain socket if one is given
+int serve(const char* path, const char* socketPath)
+{
+    query_server server;
+    if (!server.load(list_corpus_files(path)))
+        return -1;
+    if (socketPath)
+        return server.serve_socket(socketPath) ? 0 : -1;
+    server.serve_stdin();
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // "cw1 index <files...>" writes the word index of each file next to it
+    if (argc > 1 && strcmp(argv[1], "index") == 0)
+        return build_indices(argc - 2, argv + 2);
+
+    // "cw1 stream <file> [words...]" reads the file block by block instead of mapping it
+    if (argc > 2 && strcmp(argv[1], "stream") == 0)
+        return stream_count(argv[2], word_list(argc - 3, argv + 3));
+
+    // "cw1 async <file> [--direct] [words...]" overlaps reading (optionally bypassing the page cache) and counting
+    if (argc > 2 && strcmp(argv[1], "async") == 0)
+    {
+        bool direct = argc > 3 && strcmp(argv[3], "--direct") == 0;
+        return async_count(argv[2], direct, word_list(argc - 3 - direct, argv + 3 + direct));
+    }
+
+    // "cw1 phrase <path> <phrases...>" counts multi-word phrases such as "to be or not"
+    if (argc > 2 && strcmp(argv[1], "phrase") == 0)
+        return count_phrases(argv[2], argc - 3, argv + 3);
+
+    // "cw1 top <path> [k]" lists the k (default 10) most frequent words
+    if (argc > 2 && strcmp(argv[1], "top") == 0)
+    {
+        size_t k = 10;
+        if (argc > 3 && !parse_count("k", argv[3], SIZE_MAX, k))
+            return -1;
+        return top_words(argv[2], k);
+    }
+
+    // "cw1 approx <path> [options] [words...]" estimates counts with a count-min sketch
+    if (argc > 2 && strcmp(argv[1], "approx") == 0)
+        return approximate_count(argv[2], argc - 3, argv + 3);
+
+    // "cw1 fuzzy <path> <k> [words...]" also counts misspellings, up to edit distance k
+    if (argc > 3 && strcmp(argv[1], "fuzzy") == 0)
+    {
+        // Words of at most FUZZY_MAX_LENGTH letters are never further apart than that
+        size_t maxDistance = 0;
+        if (!parse_count("k", argv[3], FUZZY_MAX_LENGTH, maxDistance))
+            return -1;
+        return fuzzy_count(argv[2], int(maxDistance), word_list(argc - 4, argv + 4));
+    }
+
+    // "cw1 match <path> <patterns...>" counts all the words matching "lov*", "wom?n", ...
+    if (argc > 2 && strcmp(argv[1], "match") == 0)
+        return match_patterns(argv[2], argc - 3, argv + 3);
+
+    // "cw1 substr <path> <strings...>" counts any substring, such as "ove" or "the s"
+    if (argc > 2 && strcmp(argv[1], "substr") == 0)
+        return count_substrings(argv[2], argc - 3, argv + 3);
+
+    // "cw1 fm <path> <strings...>" does the same with a compressed FM-index instead
+    if (argc > 2 && strcmp(argv[1], "fm") == 0)
+        return count_substrings_compressed(argv[2], argc - 3, argv + 3);
+
+    // "cw1 kwic <path> <token> [--chars N | --lines N] [--max M]" shows the matches in context
+    if (argc > 3 && strcmp(argv[1], "kwic") == 0)
+        return show_in_context(argv[2], argv[3], argc - 4, argv + 4);
+
+    // "cw1 tfidf <path> [k]" lists the k (default 10) most characteristic words of each file
+    if (argc > 2 && strcmp(argv[1], "tfidf") == 0)
+    {
+        size_t k = 10;
+        if (argc > 3 && !parse_count("k", argv[3], SIZE_MAX, k))
+            return -1;
+        return top_tfidf(argv[2], k);
+    }
+
+    // "cw1 histogram <path> <token> <window bytes | heading>" counts per window, or per section such as "CHAPTER"
+    if (argc > 4 && strcmp(argv[1], "histogram") == 0)
+        return token_histogram(argv[2], argv[3], argv[4]);
+
+    // "cw1 batch <path> <word list file>" counts thousands of words (one per line) in a single pass
+    if (argc > 3 && strcmp(argv[1], "batch") == 0)
+        return batch_count(argv[2], argv[3]);
+
+    // "cw1 serve <path> [socket]" stays resident and answers queries (see server.h for the protocol)
+    if (argc > 2 && strcmp(argv[1], "serve") == 0)
+        return serve(argv[2], argc > 3 ? argv[3] : nullptr);
+
+    // Example dataset folder (or a single file), unless one is given on the command line
+    const char * path = argc > 1 ? argv[1] : "dataset";
+    auto words = word_list(argc - 2, argv + 2);
+    if (!std::filesystem::exists(path))
+    {
+        std::cerr << "Error: \"" << path << "\" not found: please make sure it exists, and if it's a relative path, it's under your WORKING directory" << std::endl;
+        return -1;
+    }
+    auto files = list_corpus_files(path);
+    if (files.empty())
+    {
+        std::cerr << "Error: No .txt files found in " << path << std::endl;
+        return -1;
+    }
+
+    // All the files are counted concurrently, largest first
+    auto start = std::chrono::steady_clock::now();
+    auto results = count_words_in_files(files, words);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int result = 0;
+    std::vector<size_t> total(words.size(), 0);
+    uint64_t totalSize = 0;
+    for (auto& r : results)
+    {
+        if (!r.ok)
+        {
+            result = -1;
+            continue;
+        }
+        if (r.staleIndex || r.corruptIndex)
+            std::cout << "Index " << index_path_for(r.path) << (r.staleIndex ? " is out of date" : " is corrupt")
+                      << ", scanning the file instead (run \"cw1 index " << r.path << "\" to rebuild it)." << std::endl;
+        std::cout << r.path << " (" << r.size << " bytes" << (r.fromIndex ? ", from index" : "") << ")" << std::endl;
+        print_occurrences(words, r.occurrences);
+        for (size_t i = 0; i < words.size(); ++i)
+            total[i] += r.occurrences[i];
+        totalSize += r.size;
+    }
+    if (results.size() > 1)
+    {
+        std::cout << "All " << results.size() << " files (" << totalSize << " bytes)" << std::endl;
+        print_occurrences(words, total);
+    }
+    std::cout << "Counted in " << elapsed * 1e3 << " ms" << std::endl;
+    return result;
+}
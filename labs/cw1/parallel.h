@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+// Below this many bytes per thread, spawning the threads costs more than the scan itself
+constexpr size_t PARALLEL_MIN_CHUNK = 1 << 20;
+
+// A per-thread result padded to its own cache line, so that threads updating neighbouring
+// slots of an array don't keep stealing the line from each other (false sharing)
+template<typename T>
+struct alignas(64) per_thread
+{
+    T value{};
+};
+
+// One thread per hardware thread, or just one if that's unknown
+inline unsigned default_num_threads()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// How many chunks to split size bytes into: one per thread (0: one per hardware thread),
+// but none smaller than minChunk bytes
+inline unsigned num_chunks(size_t size, unsigned numThreads, size_t minChunk)
+{
+    if (numThreads == 0)
+        numThreads = default_num_threads();
+    size_t maxChunks = std::max<size_t>(1, size / std::max<size_t>(minChunk, 1));
+    return unsigned(std::min<size_t>(numThreads, maxChunks));
+}
+
+// Split [0, size) into numChunks contiguous ranges of (nearly) equal size and call
+// f(chunkIndex, begin, end) for each one concurrently. The calling thread takes chunk 0.
+template<typename F>
+void run_chunks(size_t size, unsigned numChunks, F&& f)
+{
+    numChunks = std::max(numChunks, 1u);
+    std::vector<std::thread> threads;
+    threads.reserve(numChunks - 1);
+    for (unsigned i = 1; i < numChunks; ++i)
+        threads.emplace_back([&f, i, size, numChunks] { f(i, size * i / numChunks, size * (i + 1) / numChunks); });
+    f(0u, size_t(0), size / numChunks);
+    for (auto& t : threads)
+        t.join();
+}
+
+// Call f(item, threadsPerItem) for every item in [0, sizes.size()) on a pool of workers (0 threads: one
+// per hardware thread). Each worker takes the next item off a shared list, largest first: a big item
+// picked up last would keep one worker busy long after the others are done. With fewer items than
+// threads, each call gets numThreads / workers threads to split its own item with.
+template<typename F>
+void run_largest_first(const std::vector<uint64_t>& sizes, unsigned numThreads, F&& f)
+{
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return sizes[lhs] > sizes[rhs]; });
+
+    if (numThreads == 0)
+        numThreads = default_num_threads();
+    auto numWorkers = unsigned(std::max<size_t>(1, std::min<size_t>(numThreads, order.size())));
+    auto threadsPerItem = std::max(1u, numThreads / numWorkers);
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+        for (size_t i = next++; i < order.size(); i = next++)
+            f(order[i], threadsPerItem);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < numWorkers; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+}
+
+// Sort [first, last) in parallel: one contiguous run per thread is sorted with std::sort, then the runs
+// are merged pairwise through a buffer, the merges of each round running concurrently
+template<typename It, typename Compare>
+void parallel_sort(It first, It last, Compare comp, unsigned numThreads = 0)
+{
+    using T = typename std::iterator_traits<It>::value_type;
+    const size_t size = size_t(last - first);
+    auto numChunks = num_chunks(size * sizeof(T), numThreads, PARALLEL_MIN_CHUNK);
+    if (numChunks <= 1)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+    // Same split as run_chunks
+    std::vector<size_t> bounds(numChunks + 1);
+    for (unsigned i = 0; i <= numChunks; ++i)
+        bounds[i] = size * i / numChunks;
+    run_chunks(numChunks, numChunks, [&](unsigned chunk, size_t, size_t) {
+        std::sort(first + bounds[chunk], first + bounds[chunk + 1], comp);
+    });
+
+    // Each round merges from one of the range and the buffer into the other
+    std::vector<T> buffer(size);
+    bool inBuffer = false;
+    for (unsigned width = 1; width < numChunks; width *= 2)
+    {
+        unsigned numMerges = (numChunks + 2 * width - 1) / (2 * width);
+        run_chunks(numMerges, numMerges, [&](unsigned m, size_t, size_t) {
+            auto lo = bounds[std::min(numChunks, 2 * m * width)];
+            auto mid = bounds[std::min(numChunks, 2 * m * width + width)];
+            auto hi = bounds[std::min(numChunks, 2 * m * width + 2 * width)];
+            if (inBuffer)
+                std::merge(buffer.begin() + lo, buffer.begin() + mid, buffer.begin() + mid, buffer.begin() + hi, first + lo, comp);
+            else
+                std::merge(first + lo, first + mid, first + mid, first + hi, buffer.begin() + lo, comp);
+        });
+        inBuffer = !inBuffer;
+    }
+    if (inBuffer)
+        std::copy(buffer.begin(), buffer.end(), first);
+}
+
+template<typename T, typename Compare>
+void parallel_sort(std::vector<T>& data, Compare comp, unsigned numThreads = 0)
+{
+    parallel_sort(data.begin(), data.end(), comp, numThreads);
+}
@@ -0,0 +1,117 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+
+#include "aho_corasick.h"
+#include "hash.h"
+#include "parallel.h"
+#include "text.h"
+#include "words.h"
+
+uint64_t perfect_hash::hash_word(std::string_view word)
+{
+    return mix_hash(hash_folded(word));
+}
+
+bool perfect_hash::equals_folded_key(std::string_view word, const std::string& key)
+{
+    return equals_folded(word.data(), key.data(), key.size());
+}
+
+size_t perfect_hash::slot_of(uint64_t hash, uint32_t seed) const
+{
+    return size_t(mix_hash(hash ^ (uint64_t(seed) * 0x9e3779b97f4a7c15ull)) % keys.size());
+}
+
+perfect_hash::perfect_hash(const std::vector<std::string_view>& words)
+{
+    std::vector<std::string> distinct;
+    for (auto word : words)
+        distinct.push_back(fold_case(word));
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    if (distinct.empty())
+        return;
+    keys.resize(distinct.size());
+    seeds.assign(distinct.size() / 4 + 1, 0);
+
+    std::vector<std::vector<uint32_t>> buckets(seeds.size());
+    std::vector<uint64_t> hashes(distinct.size());
+    for (size_t i = 0; i < distinct.size(); ++i)
+    {
+        hashes[i] = hash_word(distinct[i]);
+        buckets[bucket_of(hashes[i])].push_back(uint32_t(i));
+    }
+    std::vector<uint32_t> order(buckets.size());
+    for (size_t b = 0; b < order.size(); ++b)
+        order[b] = uint32_t(b);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+    // Displace: try seeds until the whole bucket lands on free slots (distinct from each other too)
+    std::vector<bool> taken(keys.size(), false);
+    std::vector<size_t> slots;
+    for (auto b : order)
+    {
+        if (buckets[b].empty())
+            break;
+        for (uint32_t seed = 0;; ++seed)
+        {
+            slots.clear();
+            for (auto i : buckets[b])
+            {
+                auto slot = slot_of(hashes[i], seed);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                    break;
+                slots.push_back(slot);
+            }
+            if (slots.size() < buckets[b].size())
+                continue;
+            seeds[b] = seed;
+            for (size_t k = 0; k < slots.size(); ++k)
+            {
+                taken[slots[k]] = true;
+                keys[slots[k]] = std::move(distinct[buckets[b][k]]);
+            }
+            break;
+        }
+    }
+}
+
+std::vector<size_t> count_words_batch(std::string_view data, const std::vector<std::string_view>& words, unsigned numThreads)
+{
+    std::vector<size_t> counts(words.size(), 0);
+    std::vector<std::string_view> hashed, scanned;
+    for (auto word : words)
+        (is_word(word) ? hashed : scanned).push_back(word);
+
+    perfect_hash table(hashed);
+    if (table.size() > 0)
+    {
+        auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+        std::vector<std::vector<size_t>> slotCounts(numChunks);
+        run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+            auto& local = slotCounts[chunk];
+            local.assign(table.size(), 0);
+            for_each_word(data, begin, end, [&](std::string_view word) {
+                auto slot = table.find(word);
+                if (slot != SIZE_MAX)
+                    ++local[slot];
+            });
+        });
+        for (unsigned chunk = 1; chunk < numChunks; ++chunk)
+            for (size_t s = 0; s < table.size(); ++s)
+                slotCounts[0][s] += slotCounts[chunk][s];
+        for (size_t i = 0; i < words.size(); ++i)
+            if (is_word(words[i]))
+                counts[i] = slotCounts[0][table.find(words[i])];
+    }
+
+    if (!scanned.empty())
+    {
+        auto scannedCounts = aho_corasick(scanned).count(data);
+        for (size_t i = 0, s = 0; i < words.size(); ++i)
+            if (!is_word(words[i]))
+                counts[i] = scannedCounts[s++];
+    }
+    return counts;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal perfect hash of a fixed set of words (case ignored): each of the n distinct words gets its own
+// slot in [0, n), with no empty slots and no probing. Built by hash-and-displace: the words are split into
+// buckets of about 4 by one hash, and, biggest bucket first, each bucket gets the first seed that sends
+// all its words to free slots with a second hash. A lookup is two hashes of the word, one seed load and
+// one compare against the slot's word, to turn away words that aren't in the set.
+class perfect_hash
+{
+private:
+    // Folded word of each slot
+    std::vector<std::string> keys;
+    // Seed of each bucket
+    std::vector<uint32_t> seeds;
+
+    size_t bucket_of(uint64_t hash) const { return size_t((hash >> 32) % seeds.size()); }
+    size_t slot_of(uint64_t hash, uint32_t seed) const;
+public:
+    perfect_hash() = default;
+    // Duplicates (in any case) share a slot
+    explicit perfect_hash(const std::vector<std::string_view>& words);
+
+    // Slot of the word (any case), or SIZE_MAX if it's not one of the set
+    size_t find(std::string_view word) const
+    {
+        if (keys.empty())
+            return SIZE_MAX;
+        auto hash = hash_word(word);
+        auto slot = slot_of(hash, seeds[bucket_of(hash)]);
+        auto& key = keys[slot];
+        return key.size() == word.size() && equals_folded_key(word, key) ? slot : SIZE_MAX;
+    }
+
+    size_t size() const { return keys.size(); }
+    const std::string& key(size_t slot) const { return keys[slot]; }
+
+    static uint64_t hash_word(std::string_view word);
+    static bool equals_folded_key(std::string_view word, const std::string& key);
+};
+
+// Count many words at once (thousands), with the same result as calc_token_occurrences for each. The
+// all-letter words are compiled into a perfect hash, then a single parallel tokenization pass looks up
+// every word of the corpus in it and bumps per-thread counters, summed at the end. Words with other
+// characters in them can't be found by tokenizing, so they're counted by one Aho-Corasick pass.
+std::vector<size_t> count_words_batch(std::string_view data, const std::vector<std::string_view>& words, unsigned numThreads = 0);
@@ -0,0 +1,168 @@
+#include "phrase_index.h"
+
+#include <algorithm>
+
+#include "hash.h"
+#include "parallel.h"
+#include "words.h"
+
+// LEB128: 7 bits per byte, high bit set on all but the last byte
+static void write_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+// Walks the positions of one posting list in increasing order
+struct posting_cursor
+{
+    const uint8_t* ptr;
+    const uint8_t* end;
+    uint64_t position = 0;
+
+    // Move to the next position. Returns false at the end of the list
+    bool next()
+    {
+        if (ptr == end)
+            return false;
+        uint64_t delta = 0;
+        int shift = 0;
+        uint8_t byte;
+        do
+        {
+            byte = *ptr++;
+            delta |= uint64_t(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        position += delta;
+        return true;
+    }
+
+    // Move to the first position >= target. Returns false if there's none
+    bool advance_to(uint64_t target)
+    {
+        while (position < target)
+            if (!next())
+                return false;
+        return true;
+    }
+};
+
+void phrase_index::build(std::string_view data, unsigned numThreads)
+{
+    text = data;
+    wordIds.clear();
+
+    // Each thread collects the positions of the words starting in its chunk. Chunks are in order, so
+    // appending the chunks' positions one after the other keeps every list sorted.
+    using position_map = std::unordered_map<std::string_view, std::vector<uint64_t>, folded_hash, folded_equal>;
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<position_map> chunkPositions(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& map = chunkPositions[chunk];
+        for_each_word(data, begin, end, [&](std::string_view word) { map[word].push_back(uint64_t(word.data() - data.data())); });
+    });
+
+    // Number the words, and remember where each one's positions are in every chunk
+    std::vector<std::vector<const std::vector<uint64_t>*>> sources;
+    for (unsigned chunk = 0; chunk < numChunks; ++chunk)
+        for (auto& kv : chunkPositions[chunk])
+        {
+            auto it = wordIds.try_emplace(fold_case(kv.first), uint32_t(wordIds.size())).first;
+            if (it->second == sources.size())
+                sources.emplace_back();
+            sources[it->second].push_back(&kv.second);
+        }
+
+    // Delta-encode the lists in parallel, words being dealt out round-robin to the encoders (which
+    // are "chunks" of a range of encoder indices here)
+    std::vector<std::vector<uint8_t>> encoded(sources.size());
+    counts.assign(sources.size(), 0);
+    auto numEncoders = std::max(1u, std::min<unsigned>(numChunks, unsigned(sources.size())));
+    run_chunks(numEncoders, numEncoders, [&](unsigned encoder, size_t, size_t) {
+        for (size_t w = encoder; w < sources.size(); w += numEncoders)
+        {
+            uint64_t previous = 0;
+            for (auto positions : sources[w])
+                for (auto p : *positions)
+                {
+                    write_varint(encoded[w], p - previous);
+                    previous = p;
+                }
+            for (auto positions : sources[w])
+                counts[w] += positions->size();
+        }
+    });
+    chunkPositions.clear();
+
+    postingOffsets.assign(1, 0);
+    size_t total = 0;
+    for (auto& e : encoded)
+        postingOffsets.push_back(total += e.size());
+    postings.resize(total);
+    for (size_t w = 0; w < encoded.size(); ++w)
+        std::copy(encoded[w].begin(), encoded[w].end(), postings.begin() + postingOffsets[w]);
+}
+
+bool phrase_index::is_phrase(std::string_view token)
+{
+    return !token.empty() && is_letter(token.front()) && is_letter(token.back());
+}
+
+uint64_t phrase_index::count(std::string_view phrase) const
+{
+    if (!is_phrase(phrase))
+        return 0;
+
+    // Split the phrase into its words, each with its offset from the start of the phrase
+    struct term { uint32_t id; uint64_t offset; posting_cursor cursor; };
+    std::vector<term> terms;
+    for_each_word(phrase, 0, phrase.size(), [&](std::string_view word) {
+        auto it = wordIds.find(fold_case(word));
+        uint32_t id = it == wordIds.end() ? UINT32_MAX : it->second;
+        terms.push_back({ id, uint64_t(word.data() - phrase.data()), {} });
+    });
+    for (auto& t : terms)
+    {
+        if (t.id == UINT32_MAX)
+            return 0;
+        t.cursor.ptr = postings.data() + postingOffsets[t.id];
+        t.cursor.end = postings.data() + postingOffsets[t.id + 1];
+        // Every cursor starts on its first position
+        if (!t.cursor.next())
+            return 0;
+    }
+    if (terms.size() == 1)
+        return counts[terms[0].id];
+
+    // Drive the intersection with the rarest word, and test the others at the same phrase start
+    auto rarest = std::min_element(terms.begin(), terms.end(), [&](const term& lhs, const term& rhs) { return counts[lhs.id] < counts[rhs.id]; });
+    std::swap(*rarest, terms[0]);
+
+    auto folded = fold_case(phrase);
+    uint64_t numOccurrences = 0;
+    auto& driver = terms[0];
+    do
+    {
+        if (driver.cursor.position < driver.offset)
+            continue;
+        uint64_t start = driver.cursor.position - driver.offset;
+        if (start + phrase.size() > text.size())
+            break;
+        bool found = true;
+        for (size_t i = 1; i < terms.size() && found; ++i)
+        {
+            if (!terms[i].cursor.advance_to(start + terms[i].offset))
+                return numOccurrences;
+            found = terms[i].cursor.position == start + terms[i].offset;
+        }
+        // All the words are in place; the separators between them must be the phrase's too
+        if (found && equals_folded(text.data() + start, folded.data(), folded.size()))
+            ++numOccurrences;
+    } while (driver.cursor.next());
+    return numOccurrences;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Positional inverted index: for every word, the byte offsets of all its occurrences, stored as
+// varint-encoded deltas. Phrases such as "to be or not" are counted by intersecting the postings of their
+// words at the right relative offsets and checking the separators in between against the text, which
+// gives exactly the calc_token_occurrences count of the phrase without scanning the corpus.
+class phrase_index
+{
+private:
+    // The indexed corpus, needed to check separators. It must outlive the index
+    std::string_view text;
+    // Lowercased word -> word id
+    std::unordered_map<std::string, uint32_t> wordIds;
+    // Number of occurrences of each word
+    std::vector<uint64_t> counts;
+    // The postings of word i are postings[postingOffsets[i], postingOffsets[i + 1])
+    std::vector<uint64_t> postingOffsets;
+    std::vector<uint8_t> postings;
+public:
+    // Tokenize the corpus in parallel (0 threads: one per hardware thread) and build the postings
+    void build(std::string_view data, unsigned numThreads = 0);
+
+    // Can the index answer this token? It needs at least one word, and must start and end with a letter
+    // so that the letter-boundary tests fall on word boundaries.
+    static bool is_phrase(std::string_view token);
+
+    // Occurrences of a phrase (see is_phrase), same as calc_token_occurrences
+    uint64_t count(std::string_view phrase) const;
+
+    size_t num_words() const { return counts.size(); }
+    // Size of the postings, in bytes
+    size_t postings_size() const { return postings.size(); }
+};
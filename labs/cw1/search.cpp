@@ -0,0 +1,348 @@
+#include "search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "bits.h"
+#include "parallel.h"
+#include "simd.h"
+#include "text.h"
+
+size_t calc_token_occurrences(std::string_view data, const char* token)
+{
+    size_t numOccurrences = 0;
+    size_t tokenLen = strlen(token);
+    if (tokenLen == 0 || tokenLen > data.size())
+        return 0;
+    // the corpus isn't lowercased in memory, so fold the token once and each corpus byte as we compare it
+    std::string folded = fold_case(std::string_view(token, tokenLen));
+    for (size_t i = 0; i + tokenLen <= data.size(); ++i)
+    {
+        // test 1: does this match the token?
+        size_t j = 0;
+        while (j < tokenLen && fold_case(data[i + j]) == folded[j])
+            ++j;
+        if (j != tokenLen)
+            continue;
+
+        // test 2: is the prefix a non-letter character?
+        if (i > 0 && is_letter(data[i - 1]))
+            continue;
+
+        // test 3: is the suffix a non-letter character?
+        auto iSuffix = i + tokenLen;
+        if (iSuffix < data.size() && is_letter(data[iSuffix]))
+            continue;
+        ++numOccurrences;
+    }
+    return numOccurrences;
+}
+
+// Count a match, and keep its position if the caller wants them
+static inline void record_match(size_t pos, size_t& count, std::vector<size_t>* positions)
+{
+    ++count;
+    if (positions)
+        positions->push_back(pos);
+}
+
+#ifdef CW1_X86
+
+// equals_folded, 16 bytes at a time: the corpus bytes get the case bit set on letters only (OR 0x20
+// masked by letters_sse2), then are compared against the folded token. The last block overlaps the one
+// before it rather than reading past n bytes, so short comparisons are left to the scalar loop.
+static inline bool equals_folded_sse2(const char* text, const char* folded, size_t n)
+{
+    if (n < 16)
+        return equals_folded(text, folded, n);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    for (size_t i = 0;; i += 16)
+    {
+        if (i + 16 > n)
+            i = n - 16;
+        __m128i v = _mm_loadu_si128((const __m128i*)(text + i));
+        v = _mm_or_si128(v, _mm_and_si128(letters_sse2(v), caseBit));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_loadu_si128((const __m128i*)(folded + i)))) != 0xffff)
+            return false;
+        if (i + 16 == n)
+            return true;
+    }
+}
+
+// SSE2 is part of x86-64, so this needs no special compiler flags
+static size_t count_token_range_sse2(std::string_view data, std::string_view folded, size_t begin, size_t end, std::vector<size_t>* positions)
+{
+    const char* text = data.data();
+    const size_t size = data.size();
+    const size_t tokenLen = folded.size();
+    const size_t middleLen = tokenLen > 2 ? tokenLen - 2 : 0;
+
+    // Letters are compared with the case bit forced on, which folds exactly A-Z onto a-z
+    const char first = folded[0], last = folded[tokenLen - 1];
+    const __m128i firstChar = _mm_set1_epi8(first);
+    const __m128i lastChar = _mm_set1_epi8(last);
+    const __m128i firstCase = _mm_set1_epi8(is_letter(first) ? 0x20 : 0);
+    const __m128i lastCase = _mm_set1_epi8(is_letter(last) ? 0x20 : 0);
+
+    // The vector loop reads the byte before each candidate, so position 0 is checked on its own
+    size_t count = 0;
+    size_t i = begin;
+    if (i == 0 && is_token_at(data, i++, folded))
+        record_match(0, count, positions);
+    for (; i + 16 <= end && i + tokenLen + 16 <= size; i += 16)
+    {
+        __m128i before = _mm_loadu_si128((const __m128i*)(text + i - 1));
+        __m128i head = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i tail = _mm_loadu_si128((const __m128i*)(text + i + tokenLen - 1));
+        __m128i after = _mm_loadu_si128((const __m128i*)(text + i + tokenLen));
+        __m128i candidates = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(head, firstCase), firstChar),
+                                           _mm_cmpeq_epi8(_mm_or_si128(tail, lastCase), lastChar));
+        candidates = _mm_andnot_si128(_mm_or_si128(letters_sse2(before), letters_sse2(after)), candidates);
+        uint32_t mask = uint32_t(_mm_movemask_epi8(candidates));
+        while (mask)
+        {
+            size_t pos = i + count_trailing_zeros(mask);
+            if (equals_folded_sse2(text + pos + 1, folded.data() + 1, middleLen))
+                record_match(pos, count, positions);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < end; ++i)
+        if (is_token_at(data, i, folded))
+            record_match(i, count, positions);
+    return count;
+}
+
+CW1_TARGET_AVX2 static size_t count_token_range_avx2(std::string_view data, std::string_view folded, size_t begin, size_t end, std::vector<size_t>* positions)
+{
+    const char* text = data.data();
+    const size_t size = data.size();
+    const size_t tokenLen = folded.size();
+    const size_t middleLen = tokenLen > 2 ? tokenLen - 2 : 0;
+
+    // Letters are compared with the case bit forced on, which folds exactly A-Z onto a-z
+    const char first = folded[0], last = folded[tokenLen - 1];
+    const __m256i firstChar = _mm256_set1_epi8(first);
+    const __m256i lastChar = _mm256_set1_epi8(last);
+    const __m256i firstCase = _mm256_set1_epi8(is_letter(first) ? 0x20 : 0);
+    const __m256i lastCase = _mm256_set1_epi8(is_letter(last) ? 0x20 : 0);
+
+    // The vector loop reads the byte before each candidate, so position 0 is checked on its own
+    size_t count = 0;
+    size_t i = begin;
+    if (i == 0 && is_token_at(data, i++, folded))
+        record_match(0, count, positions);
+    for (; i + 32 <= end && i + tokenLen + 32 <= size; i += 32)
+    {
+        __m256i before = _mm256_loadu_si256((const __m256i*)(text + i - 1));
+        __m256i head = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i tail = _mm256_loadu_si256((const __m256i*)(text + i + tokenLen - 1));
+        __m256i after = _mm256_loadu_si256((const __m256i*)(text + i + tokenLen));
+        __m256i candidates = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(head, firstCase), firstChar),
+                                              _mm256_cmpeq_epi8(_mm256_or_si256(tail, lastCase), lastChar));
+        candidates = _mm256_andnot_si256(_mm256_or_si256(letters_avx2(before), letters_avx2(after)), candidates);
+        uint32_t mask = uint32_t(_mm256_movemask_epi8(candidates));
+        while (mask)
+        {
+            size_t pos = i + count_trailing_zeros(mask);
+            if (equals_folded_sse2(text + pos + 1, folded.data() + 1, middleLen))
+                record_match(pos, count, positions);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < end; ++i)
+        if (is_token_at(data, i, folded))
+            record_match(i, count, positions);
+    return count;
+}
+
+static bool cpu_has_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // The OS must also save the YMM registers on context switches
+    __cpuid(info, 1);
+    const int osxsave = 1 << 27, avx = 1 << 28;
+    if ((info[2] & (osxsave | avx)) != (osxsave | avx) || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+simd_level best_simd_level()
+{
+#ifdef CW1_X86
+    static const simd_level level = cpu_has_avx2() ? simd_level::avx2 : simd_level::sse2;
+    return level;
+#else
+    return simd_level::scalar;
+#endif
+}
+
+const char* simd_level_name(simd_level level)
+{
+    switch (level)
+    {
+    case simd_level::avx2: return "avx2";
+    case simd_level::sse2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+// Count the matches that start in [begin, end), and collect their positions if asked. The bytes around the range are still looked at for the
+// boundary tests, so adjacent ranges add up to exactly the count of the whole corpus.
+static size_t count_token_range(std::string_view data, std::string_view folded, size_t begin, size_t end, simd_level level, std::vector<size_t>* positions = nullptr)
+{
+    end = std::min(end, data.size() - folded.size() + 1);
+    if (begin >= end)
+        return 0;
+    // Never run code the CPU can't execute, whatever was asked for
+    if (level > best_simd_level())
+        level = best_simd_level();
+    switch (level)
+    {
+#ifdef CW1_X86
+    case simd_level::avx2: return count_token_range_avx2(data, folded, begin, end, positions);
+    case simd_level::sse2: return count_token_range_sse2(data, folded, begin, end, positions);
+#endif
+    default:
+    {
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i)
+            if (is_token_at(data, i, folded))
+                record_match(i, count, positions);
+        return count;
+    }
+    }
+}
+
+size_t calc_token_occurrences_simd(std::string_view data, const char* token, simd_level level)
+{
+    size_t tokenLen = strlen(token);
+    if (tokenLen == 0 || tokenLen > data.size())
+        return 0;
+    std::string folded = fold_case(std::string_view(token, tokenLen));
+    return count_token_range(data, folded, 0, data.size(), level);
+}
+
+size_t calc_token_occurrences_parallel(std::string_view data, const char* token, unsigned numThreads, simd_level level)
+{
+    size_t tokenLen = strlen(token);
+    if (tokenLen == 0 || tokenLen > data.size())
+        return 0;
+    std::string folded = fold_case(std::string_view(token, tokenLen));
+
+    // Each thread owns the match starts of its chunk, and reads up to tokenLen bytes past the chunk
+    // end (plus one byte either side for the letter tests), so no match is lost or counted twice.
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<per_thread<size_t>> counts(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        counts[chunk].value = count_token_range(data, folded, begin, end, level);
+    });
+
+    size_t total = 0;
+    for (auto& count : counts)
+        total += count.value;
+    return total;
+}
+
+std::vector<size_t> find_token_occurrences(std::string_view data, const char* token, unsigned numThreads)
+{
+    size_t tokenLen = strlen(token);
+    if (tokenLen == 0 || tokenLen > data.size())
+        return {};
+    std::string folded = fold_case(std::string_view(token, tokenLen));
+
+    // Same chunks as calc_token_occurrences_parallel, each collecting its own positions in order
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<std::vector<size_t>> chunkPositions(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        count_token_range(data, folded, begin, end, best_simd_level(), &chunkPositions[chunk]);
+    });
+
+    std::vector<size_t> positions;
+    for (auto& p : chunkPositions)
+        positions.insert(positions.end(), p.begin(), p.end());
+    return positions;
+}
+
+std::vector<histogram_bin> calc_token_histogram(std::string_view data, const char* token, const segmentation& segments, unsigned numThreads)
+{
+    const size_t tokenLen = strlen(token);
+    const std::string folded = fold_case(std::string_view(token, tokenLen));
+    const bool windows = segments.windowSize > 0;
+    if (!windows && segments.delimiter.empty())
+        return {};
+    const size_t numWindows = windows ? (data.size() + segments.windowSize - 1) / segments.windowSize : 0;
+
+    struct chunk_histogram
+    {
+        // Windows: one count per window the chunk overlaps, from firstWindow on. Sections: counts[0] is
+        // for the section that was open at the chunk start, counts[i] for the one starting at
+        // sectionStarts[i - 1].
+        std::vector<size_t> counts;
+        size_t firstWindow = 0;
+        std::vector<size_t> sectionStarts;
+    };
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<chunk_histogram> histograms(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& h = histograms[chunk];
+        std::vector<size_t> positions;
+        if (tokenLen > 0 && tokenLen <= data.size())
+            count_token_range(data, folded, begin, end, best_simd_level(), &positions);
+        if (windows)
+        {
+            if (begin < end)
+            {
+                h.firstWindow = begin / segments.windowSize;
+                h.counts.assign((end - 1) / segments.windowSize - h.firstWindow + 1, 0);
+            }
+            for (auto pos : positions)
+                ++h.counts[pos / segments.windowSize - h.firstWindow];
+            return;
+        }
+        for (size_t i = data.find(segments.delimiter, begin); i < end; i = data.find(segments.delimiter, i + 1))
+            if (i == 0 || data[i - 1] == '\n')
+                h.sectionStarts.push_back(i);
+        h.counts.assign(h.sectionStarts.size() + 1, 0);
+        for (auto pos : positions)
+            ++h.counts[std::upper_bound(h.sectionStarts.begin(), h.sectionStarts.end(), pos) - h.sectionStarts.begin()];
+    });
+
+    std::vector<histogram_bin> bins;
+    if (windows)
+    {
+        for (size_t w = 0; w < numWindows; ++w)
+            bins.push_back({ w * segments.windowSize, std::min(data.size(), (w + 1) * segments.windowSize), 0 });
+        for (auto& h : histograms)
+            for (size_t w = 0; w < h.counts.size(); ++w)
+                bins[h.firstWindow + w].count += h.counts[w];
+        return bins;
+    }
+    // The text before the first section start is a section of its own, then each chunk continues the
+    // section the previous one ended in
+    bins.push_back({ 0, data.size(), 0 });
+    for (auto& h : histograms)
+    {
+        bins.back().count += h.counts[0];
+        for (size_t i = 0; i < h.sectionStarts.size(); ++i)
+        {
+            bins.back().end = h.sectionStarts[i];
+            bins.push_back({ h.sectionStarts[i], data.size(), h.counts[i + 1] });
+        }
+    }
+    // No text before the first heading
+    if (bins.size() > 1 && bins[0].begin == bins[0].end)
+        bins.erase(bins.begin());
+    return bins;
+}
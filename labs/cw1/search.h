@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Count the occurrences of a whole word in the corpus. A match counts only if it's not preceded
+// or followed by a letter; case is ignored on both sides, so "Love" counts the same as "love"
+// (the original version lowercased only the corpus, and found nothing for a token with capitals).
+size_t calc_token_occurrences(std::string_view data, const char* token);
+
+// Instruction sets the vectorized scanner can use
+enum class simd_level { scalar, sse2, avx2 };
+
+// Best level supported by this CPU, detected once
+simd_level best_simd_level();
+const char* simd_level_name(simd_level level);
+
+// Same result as calc_token_occurrences, but tests 16/32 candidate positions at a time: the first and
+// last bytes of the token and the letter-ness of the bytes around it are compared with vector
+// instructions, and only the positions that pass all four get their middle bytes verified (16 at a
+// time too, folding the corpus bytes in registers: the mapped text is never lowercased or copied).
+size_t calc_token_occurrences_simd(std::string_view data, const char* token, simd_level level = best_simd_level());
+
+// Same result again, with the corpus split in one chunk per thread (0: one per hardware thread).
+// Chunks are counted independently and the per-thread counts summed at the end.
+size_t calc_token_occurrences_parallel(std::string_view data, const char* token, unsigned numThreads = 0, simd_level level = best_simd_level());
+
+// Byte offsets of the matches, in order, found like calc_token_occurrences_parallel
+std::vector<size_t> find_token_occurrences(std::string_view data, const char* token, unsigned numThreads = 0);
+
+// How calc_token_histogram cuts the corpus into bins
+struct segmentation
+{
+    // Fixed windows of this many bytes, if not 0
+    size_t windowSize = 0;
+    // Otherwise sections, each starting at a line that begins with this (case matters, so "CHAPTER"
+    // headings don't split at "chapter" in the prose). Text before the first one is a section too.
+    std::string delimiter;
+};
+
+// Occurrences of the token in one bin [begin, end) of the corpus, by where they start
+struct histogram_bin
+{
+    size_t begin;
+    size_t end;
+    size_t count;
+};
+
+// Occurrences of the token per window or section, in a single parallel pass: every thread finds the
+// matches and the section starts of its chunk and bins its matches into its own histogram (sections
+// numbered from its first section start), and the histograms are added up at the end once every
+// chunk's first section number is known. The counts add up to calc_token_occurrences.
+std::vector<histogram_bin> calc_token_histogram(std::string_view data, const char* token, const segmentation& segments, unsigned numThreads = 0);
@@ -0,0 +1,277 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "skip_search.h"
+#include "word_index.h"
+#include "words.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+void latency_stats::record(uint64_t nanoseconds)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (samples.size() < CAPACITY)
+        samples.push_back(nanoseconds);
+    else
+        samples[numRecorded % CAPACITY] = nanoseconds;
+    ++numRecorded;
+}
+
+std::string latency_stats::summary() const
+{
+    std::vector<uint64_t> sorted;
+    uint64_t total;
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        sorted = samples;
+        total = numRecorded;
+    }
+    std::string result = "queries=" + std::to_string(total);
+    if (sorted.empty())
+        return result;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (auto s : sorted)
+        sum += double(s);
+    auto us = [](double ns) { return std::to_string(ns / 1e3); };
+    auto percentile = [&](double p) { return double(sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))]); };
+    result += " mean_us=" + us(sum / sorted.size());
+    result += " p50_us=" + us(percentile(0.5));
+    result += " p99_us=" + us(percentile(0.99));
+    result += " max_us=" + us(double(sorted.back()));
+    return result;
+}
+
+bool query_server::load(const std::vector<std::string>& corpusPaths)
+{
+    paths = corpusPaths;
+    files.clear();
+    files.resize(paths.size());
+    phrases.clear();
+    phrases.resize(paths.size());
+    wordIds.clear();
+    wordCounts.clear();
+
+    // Tokenize each file once (in parallel within the file), then keep one count per file for every word
+    for (size_t f = 0; f < paths.size(); ++f)
+    {
+        if (!files[f].open(paths[f].c_str()))
+            return false;
+        for (auto& wc : count_words(files[f].view()))
+        {
+            auto it = wordIds.try_emplace(wc.word, wordIds.size()).first;
+            wordCounts.resize(wordIds.size() * paths.size(), 0);
+            wordCounts[it->second * paths.size() + f] = wc.count;
+        }
+        phrases[f].build(files[f].view());
+        std::cerr << "Loaded " << paths[f] << " (" << files[f].size() << " bytes)" << std::endl;
+    }
+    std::cerr << "Ready: " << wordIds.size() << " distinct words in " << paths.size() << " files" << std::endl;
+    return true;
+}
+
+std::vector<uint64_t> query_server::count_token(std::string_view token) const
+{
+    std::vector<uint64_t> perFile(paths.size(), 0);
+    if (is_word(token))
+    {
+        auto it = wordIds.find(fold_case(token));
+        if (it != wordIds.end())
+            std::copy_n(wordCounts.begin() + it->second * paths.size(), paths.size(), perFile.begin());
+    }
+    else if (phrase_index::is_phrase(token))
+    {
+        for (size_t f = 0; f < files.size(); ++f)
+            perFile[f] = phrases[f].count(token);
+    }
+    else if (!token.empty())
+    {
+        std::string terminated(token);
+        for (size_t f = 0; f < files.size(); ++f)
+            perFile[f] = calc_token_occurrences_auto(files[f].view(), terminated.c_str());
+    }
+    return perFile;
+}
+
+bool query_server::handle(std::string_view line, std::string& reply)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    auto space = line.find(' ');
+    auto command = line.substr(0, space);
+    auto argument = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+
+    reply = "ok";
+    if (command == "count")
+    {
+        auto perFile = count_token(argument);
+        uint64_t total = 0;
+        for (auto c : perFile)
+            total += c;
+        reply += " " + std::to_string(total);
+        for (auto c : perFile)
+            reply += " " + std::to_string(c);
+    }
+    else if (command == "batch")
+    {
+        while (!argument.empty())
+        {
+            auto tab = argument.find('\t');
+            uint64_t total = 0;
+            for (auto c : count_token(argument.substr(0, tab)))
+                total += c;
+            reply += " " + std::to_string(total);
+            argument = tab == std::string_view::npos ? std::string_view() : argument.substr(tab + 1);
+        }
+    }
+    else if (command == "files")
+    {
+        for (size_t f = 0; f < paths.size(); ++f)
+            reply += (f == 0 ? " " : "\t") + paths[f];
+    }
+    else if (command == "stats")
+        reply += " " + stats.summary();
+    else if (command == "quit")
+        return false;
+    else if (command.empty())
+        reply = "error empty request";
+    else
+        reply = "error unknown command " + std::string(command);
+
+    // Stats requests aren't queries, and would skew the numbers they report
+    if (command != "stats")
+        stats.record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+    return true;
+}
+
+void query_server::serve_stdin()
+{
+    std::string line, reply;
+    while (std::getline(std::cin, line) && handle(line, reply))
+        std::cout << reply << std::endl;
+}
+
+#ifdef _WIN32
+
+bool query_server::serve_socket(const char* socketPath)
+{
+    std::cerr << "Error: Unix domain sockets aren't supported on this platform, use stdin instead" << std::endl;
+    return false;
+}
+
+#else
+
+// Answer the requests of one client until it quits or disconnects
+static void serve_connection(query_server& server, int fd)
+{
+    std::string pending, reply;
+    char buffer[4096];
+    bool open = true;
+    while (open)
+    {
+        auto n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0)
+            break;
+        pending.append(buffer, size_t(n));
+        // Answer every complete line received so far, as one write per read
+        std::string replies;
+        size_t lineStart = 0;
+        for (auto newline = pending.find('\n'); open && newline != std::string::npos; newline = pending.find('\n', lineStart))
+        {
+            open = server.handle(std::string_view(pending).substr(lineStart, newline - lineStart), reply);
+            if (open)
+                replies += reply + '\n';
+            lineStart = newline + 1;
+        }
+        pending.erase(0, lineStart);
+        for (size_t written = 0; written < replies.size();)
+        {
+            auto w = write(fd, replies.data() + written, replies.size() - written);
+            if (w <= 0)
+            {
+                open = false;
+                break;
+            }
+            written += size_t(w);
+        }
+    }
+    close(fd);
+}
+
+bool query_server::serve_socket(const char* socketPath)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        std::cerr << "Error: Socket path " << socketPath << " is too long" << std::endl;
+        return false;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        std::cerr << "Error: Could not create a socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    // A socket file left over from a previous run would make bind() fail, so it's removed, but only if
+    // it is a socket (not a file given by mistake) and no server is still listening on it
+    struct stat info;
+    if (lstat(socketPath, &info) == 0)
+    {
+        if (!S_ISSOCK(info.st_mode))
+        {
+            std::cerr << "Error: " << socketPath << " exists and is not a socket" << std::endl;
+            close(listener);
+            return false;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+        if (probe >= 0)
+            close(probe);
+        if (live)
+        {
+            std::cerr << "Error: Another server is already listening on " << socketPath << std::endl;
+            close(listener);
+            return false;
+        }
+        unlink(socketPath);
+    }
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+    {
+        std::cerr << "Error: Could not listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        close(listener);
+        return false;
+    }
+    std::cerr << "Listening on " << socketPath << std::endl;
+
+    for (;;)
+    {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error: accept() failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        std::thread(serve_connection, std::ref(*this), client).detach();
+    }
+    close(listener);
+    return false;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "corpus.h"
+#include "phrase_index.h"
+
+// Exact latency percentiles over the most recent requests
+class latency_stats
+{
+private:
+    static constexpr size_t CAPACITY = 1 << 16;
+    mutable std::mutex mut;
+    // Ring buffer of the last CAPACITY latencies, in nanoseconds
+    std::vector<uint64_t> samples;
+    uint64_t numRecorded = 0;
+public:
+    void record(uint64_t nanoseconds);
+    // "queries=N mean_us=... p50_us=... p99_us=... max_us=..."
+    std::string summary() const;
+};
+
+// Long-running query server. The corpora are mapped and tokenized once at startup, after which word
+// counts are hash lookups. Requests are single lines, answered with a single line:
+//     count <token>             ok <total> <count in file 1> <count in file 2> ...
+//     batch <token>\t<token>... ok <total 1> <total 2> ...     (tabs, so tokens may contain spaces)
+//     files                     ok <file 1>\t<file 2>...
+//     stats                     ok queries=... mean_us=... p50_us=... p99_us=... max_us=...
+//     quit                      closes the connection
+// Anything else gets "error <message>". Tokens with non-letters in them aren't words: phrases are
+// answered from a positional index of each file, and the rest with a parallel scan of the mapped files.
+class query_server
+{
+private:
+    std::vector<std::string> paths;
+    std::vector<corpus> files;
+    // Lowercased word -> row of wordCounts, which holds one count per file
+    std::unordered_map<std::string, size_t> wordIds;
+    std::vector<uint64_t> wordCounts;
+    // Positional index of each file, for multi-word phrases
+    std::vector<phrase_index> phrases;
+    latency_stats stats;
+
+    // Occurrences of a token in each file
+    std::vector<uint64_t> count_token(std::string_view token) const;
+public:
+    // Map and tokenize the corpora. Prints the error and returns false on failure
+    bool load(const std::vector<std::string>& corpusPaths);
+
+    // Answer one request line. Returns false when the client asked to quit
+    bool handle(std::string_view line, std::string& reply);
+
+    // Serve requests from stdin until end of input or "quit"
+    void serve_stdin();
+
+    // Serve requests on a Unix domain socket, one thread per connection, until the process is killed.
+    // Prints the error and returns false if the socket can't be set up (or on platforms without one).
+    bool serve_socket(const char* socketPath);
+};
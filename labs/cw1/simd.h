@@ -0,0 +1,38 @@
+#pragma once
+
+// SIMD building blocks shared by the vectorized scanners (search.cpp, words.cpp). Internal: callers
+// pick a kernel with best_simd_level() from search.h.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CW1_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef CW1_X86
+
+// Only the AVX2 kernels are compiled for AVX2 (MSVC needs no flag for the intrinsics). They're only
+// called after best_simd_level() has checked that the CPU supports it.
+#ifdef __GNUC__
+#define CW1_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CW1_TARGET_AVX2
+#endif
+
+// 0xff for every ASCII letter of either case. Bytes >= 0x80 are negative in the signed compares,
+// so they never count as letters
+static inline __m128i letters_sse2(__m128i v)
+{
+    v = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), v));
+}
+
+CW1_TARGET_AVX2 static inline __m256i letters_avx2(__m256i v)
+{
+    v = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v));
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include "skip_search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "parallel.h"
+#include "search.h"
+#include "text.h"
+
+// Clamp [begin, end) to the positions where a token of length m fits
+static bool clamp_range(std::string_view data, size_t m, size_t& begin, size_t& end)
+{
+    if (m == 0 || m > data.size())
+        return false;
+    end = std::min(end, data.size() - m + 1);
+    return begin < end;
+}
+
+// The letter tests of calc_token_occurrences, for a match at position i
+static bool is_word_bounded(std::string_view data, size_t i, size_t m)
+{
+    return (i == 0 || !is_letter(data[i - 1])) && (i + m >= data.size() || !is_letter(data[i + m]));
+}
+
+horspool_searcher::horspool_searcher(std::string_view token) : folded(fold_case(token))
+{
+    size_t m = folded.size();
+    shifts.fill(uint32_t(std::max<size_t>(m, 1)));
+    // The last byte is left out, so that a match of it never shifts by 0
+    for (size_t i = 0; i + 1 < m; ++i)
+    {
+        auto shift = uint32_t(m - 1 - i);
+        shifts[uint8_t(folded[i])] = shift;
+        if (is_letter(folded[i]))
+            shifts[uint8_t(folded[i] & ~0x20)] = shift;
+    }
+}
+
+size_t horspool_searcher::count(std::string_view data, size_t begin, size_t end) const
+{
+    size_t m = folded.size();
+    if (!clamp_range(data, m, begin, end))
+        return 0;
+    const char* text = data.data();
+    const char last = folded[m - 1];
+    size_t count = 0;
+    for (size_t i = begin; i < end;)
+    {
+        char c = text[i + m - 1];
+        if (fold_case(c) == last && equals_folded(text + i, folded.data(), m - 1) && is_word_bounded(data, i, m))
+            ++count;
+        i += shifts[uint8_t(c)];
+    }
+    return count;
+}
+
+// Maximal suffix of the token for the byte order (or the reversed order): its start - 1 and its period
+static ptrdiff_t maximal_suffix(const std::string& x, bool reversed, size_t& period)
+{
+    ptrdiff_t ms = -1;
+    size_t j = 0, k = 1;
+    period = 1;
+    while (j + k < x.size())
+    {
+        auto a = uint8_t(x[j + k]);
+        auto b = uint8_t(x[ms + k]);
+        if (a == b)
+        {
+            if (k != period)
+                ++k;
+            else
+            {
+                j += period;
+                k = 1;
+            }
+        }
+        else if ((a < b) != reversed)
+        {
+            j += k;
+            k = 1;
+            period = j - ms;
+        }
+        else
+        {
+            ms = ptrdiff_t(j);
+            j = ms + 1;
+            k = period = 1;
+        }
+    }
+    return ms;
+}
+
+two_way_searcher::two_way_searcher(std::string_view token) : folded(fold_case(token))
+{
+    // The critical factorization is the later of the two maximal suffixes
+    size_t p, q;
+    auto i = maximal_suffix(folded, false, p);
+    auto j = maximal_suffix(folded, true, q);
+    split = std::max(i, j);
+    period = i > j ? p : q;
+    periodic = !folded.empty() && memcmp(folded.data(), folded.data() + period, size_t(split + 1)) == 0;
+    if (!periodic)
+        period = std::max<size_t>(split + 1, folded.size() - split - 1) + 1;
+}
+
+size_t two_way_searcher::count(std::string_view data, size_t begin, size_t end) const
+{
+    const ptrdiff_t m = ptrdiff_t(folded.size());
+    if (!clamp_range(data, size_t(m), begin, end))
+        return 0;
+    const char* x = folded.data();
+    const char* text = data.data();
+    size_t count = 0;
+    // Bytes of the left part known to match after a shift by the period (periodic tokens only)
+    ptrdiff_t memory = -1;
+    for (size_t pos = begin; pos < end;)
+    {
+        const char* y = text + pos;
+        // Right part, left to right
+        ptrdiff_t i = std::max(split, memory) + 1;
+        while (i < m && fold_case(y[i]) == x[i])
+            ++i;
+        if (i < m)
+        {
+            pos += size_t(i - split);
+            memory = -1;
+            continue;
+        }
+        // Left part, right to left
+        i = split;
+        while (i > memory && fold_case(y[i]) == x[i])
+            --i;
+        if (i <= memory && is_word_bounded(data, pos, size_t(m)))
+            ++count;
+        pos += period;
+        memory = periodic ? m - ptrdiff_t(period) - 1 : -1;
+    }
+    return count;
+}
+
+const char* search_algorithm_name(search_algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case search_algorithm::horspool: return "horspool";
+    case search_algorithm::two_way: return "two-way";
+    default: return "simd";
+    }
+}
+
+// Smallest p such that the token equals itself shifted by p (its length if it doesn't repeat), from
+// the KMP failure function
+static size_t smallest_period(const std::string& x)
+{
+    if (x.empty())
+        return 0;
+    std::vector<size_t> border(x.size() + 1, 0);
+    for (size_t i = 1, k = 0; i < x.size(); ++i)
+    {
+        while (k > 0 && x[i] != x[k])
+            k = border[k];
+        if (x[i] == x[k])
+            ++k;
+        border[i + 1] = k;
+    }
+    return x.size() - border[x.size()];
+}
+
+search_algorithm choose_search_algorithm(std::string_view token, simd_level level)
+{
+    auto twoWayMinLength = level == simd_level::scalar ? TWO_WAY_MIN_LENGTH_SCALAR : TWO_WAY_MIN_LENGTH;
+    if (token.size() >= twoWayMinLength && 2 * smallest_period(fold_case(token)) <= token.size())
+        return search_algorithm::two_way;
+    if (level == simd_level::scalar && token.size() >= HORSPOOL_MIN_LENGTH)
+        return search_algorithm::horspool;
+    return search_algorithm::simd;
+}
+
+size_t calc_token_occurrences_with(std::string_view data, const char* token, search_algorithm algorithm, unsigned numThreads)
+{
+    if (algorithm == search_algorithm::simd)
+        return calc_token_occurrences_parallel(data, token, numThreads);
+    size_t tokenLen = strlen(token);
+    if (tokenLen == 0 || tokenLen > data.size())
+        return 0;
+    horspool_searcher horspool(algorithm == search_algorithm::horspool ? std::string_view(token, tokenLen) : std::string_view());
+    two_way_searcher twoWay(algorithm == search_algorithm::two_way ? std::string_view(token, tokenLen) : std::string_view());
+
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<per_thread<size_t>> counts(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        counts[chunk].value = algorithm == search_algorithm::horspool ? horspool.count(data, begin, end) : twoWay.count(data, begin, end);
+    });
+    size_t total = 0;
+    for (auto& count : counts)
+        total += count.value;
+    return total;
+}
+
+size_t calc_token_occurrences_auto(std::string_view data, const char* token, unsigned numThreads)
+{
+    return calc_token_occurrences_with(data, token, choose_search_algorithm(token), numThreads);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "search.h"
+
+// Skip-based alternatives to the SIMD scanner, which looks at every position of the corpus: for
+// long tokens, most positions can be ruled out without being looked at.
+//
+// Like the scanners of search.cpp, both searchers count the whole-word matches that start in
+// [begin, end) while still reading the bytes around the range, so adjacent ranges add up exactly.
+
+// Boyer-Moore-Horspool: compare the last byte of the window first, and on a mismatch shift by how
+// far that byte is from the end of the token (the whole token length if it's not in it). Expected
+// shifts approach the token length on natural text, but the worst case is O(n * m).
+class horspool_searcher
+{
+private:
+    std::string folded;
+    // Shift for each corpus byte, both cases filled in so that the corpus byte needn't be folded
+    std::array<uint32_t, 256> shifts;
+public:
+    explicit horspool_searcher(std::string_view token);
+    size_t count(std::string_view data, size_t begin = 0, size_t end = SIZE_MAX) const;
+};
+
+// Two-Way (Crochemore-Perrin): the token is split at a critical factorization, the right part is
+// matched left to right and the left part right to left, and on a mismatch the window shifts by the
+// number of bytes matched or by the token's period. O(n) in the worst case with O(1) extra memory,
+// so it stays fast on repetitive text and small alphabets, where Horspool's shifts collapse.
+class two_way_searcher
+{
+private:
+    std::string folded;
+    // Critical position: the right part starts at split + 1 (split may be -1)
+    ptrdiff_t split;
+    size_t period;
+    // The token is periodic (its left part repeats in the right one): matches can overlap, and
+    // after one the bytes already known to match aren't compared again
+    bool periodic;
+public:
+    explicit two_way_searcher(std::string_view token);
+    size_t count(std::string_view data, size_t begin = 0, size_t end = SIZE_MAX) const;
+};
+
+enum class search_algorithm { simd, horspool, two_way };
+
+const char* search_algorithm_name(search_algorithm algorithm);
+
+// Crossovers of choose_search_algorithm. They come from "cw1-bench --crossover", which times every
+// algorithm against the token length and flags the lengths where the pick is over 10% slower than
+// the fastest; rerun it on the target machine rather than trusting any figures written down here.
+// Each threshold is the shortest length from which the algorithm it switches to is the faster one on
+// all the texts it's meant for, at every longer length measured, rounded up to a length the run measures.
+// Without SIMD, Horspool beats the byte-by-byte scan from this length on
+constexpr size_t HORSPOOL_MIN_LENGTH = 3;
+// Tokens this long that repeat with a period of at most half their length (e.g. "ha ha ha ha ...") use
+// Two-Way: on text made of the same repetition they match at every period, and the SIMD filter and
+// Horspool verify the whole token each time, while Two-Way remembers what matched. The thresholds are
+// the crossovers on the periodic texts of the run only, which are where it's a win: on natural text
+// the SIMD filter is an order of magnitude faster than Two-Way for any token. The SIMD crossover varies
+// between machines (from 38 to 47 bytes on "ha ha ha..." so far), so it's the longest one seen.
+constexpr size_t TWO_WAY_MIN_LENGTH = 48;
+constexpr size_t TWO_WAY_MIN_LENGTH_SCALAR = 6;
+
+// Pick the fastest algorithm for a token. With SSE2/AVX2, the SIMD filter on the first and last bytes
+// beats Horspool at every length on natural text, so skips only pay off without SIMD; Two-Way is kept
+// for long periodic tokens, whose worst case it bounds.
+search_algorithm choose_search_algorithm(std::string_view token, simd_level level = best_simd_level());
+
+// Same result as calc_token_occurrences, with the given algorithm, the corpus split in one chunk per
+// thread (0: one per hardware thread)
+size_t calc_token_occurrences_with(std::string_view data, const char* token, search_algorithm algorithm, unsigned numThreads = 0);
+
+// Same again, with the algorithm chosen by choose_search_algorithm for this CPU
+size_t calc_token_occurrences_auto(std::string_view data, const char* token, unsigned numThreads = 0);
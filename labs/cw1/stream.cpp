@@ -0,0 +1,83 @@
+#include "stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+
+#include "aho_corasick.h"
+
+std::vector<size_t> count_words_streaming(const char* filename, const std::vector<std::string_view>& words, size_t blockSize)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error: Could not open the file " << filename << std::endl;
+        return {};
+    }
+
+    aho_corasick matcher(words);
+    std::vector<size_t> counts(words.size(), 0);
+
+    // Every window is [carry | block]. The carry is the end of the previous window: the byte in front of
+    // the first position this window owns, plus the positions the previous window couldn't decide because
+    // their suffix wasn't loaded yet. A window owns the positions whose match and following byte fit in it.
+    const size_t carrySize = matcher.max_word_length() + 1;
+    blockSize = std::max(blockSize, 2 * carrySize);
+    // Not make_unique: there's no point zeroing megabytes that are about to be read into
+    std::unique_ptr<char[]> buffers[2] = {
+        std::unique_ptr<char[]>(new char[carrySize + blockSize]),
+        std::unique_ptr<char[]>(new char[carrySize + blockSize]),
+    };
+
+    auto read_block = [&](char* block) {
+        file.read(block, std::streamsize(blockSize));
+        return size_t(file.gcount());
+    };
+
+    auto add_counts = [&](std::string_view window, size_t begin, size_t end) {
+        if (begin >= end)
+            return;
+        auto windowCounts = matcher.count(window, begin, end);
+        for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] += windowCounts[i];
+    };
+
+    int current = 0;
+    size_t carried = 0;
+    size_t blockLen = read_block(buffers[current].get() + carrySize);
+    while (blockLen > 0)
+    {
+        // Read the next block while scanning this one. Only the block part of the other buffer is
+        // written, its carry is filled in from this window afterwards.
+        auto nextRead = std::async(std::launch::async, read_block, buffers[1 - current].get() + carrySize);
+
+        std::string_view window(buffers[current].get() + carrySize - carried, carried + blockLen);
+        // The first byte of a carried window only provides the prefix of the first owned position
+        size_t begin = carried > 0 ? 1 : 0;
+        size_t end = window.size() > carrySize ? window.size() - (carrySize - 1) : begin;
+        add_counts(window, begin, end);
+
+        // At the end of the file, the rest of the window is decided too
+        size_t nextLen = nextRead.get();
+        if (nextLen == 0)
+        {
+            add_counts(window, end, window.size());
+            break;
+        }
+
+        // The next window starts at the prefix byte of the first position this one didn't own
+        carried = window.size() - (end - 1);
+        memcpy(buffers[1 - current].get() + carrySize - carried, window.data() + end - 1, carried);
+        current = 1 - current;
+        blockLen = nextLen;
+    }
+    if (file.bad())
+    {
+        std::cerr << "Error: Could not read the file content." << std::endl;
+        return {};
+    }
+    return counts;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Default size of the blocks read by the streaming counter. Two of them are in memory at any time.
+constexpr size_t STREAM_BLOCK_SIZE = 4 << 20;
+
+// Count the words of the list in a file of any size, in bounded memory: the file is read in fixed size
+// blocks into two reused buffers, the next block being read while the current one is scanned. The last
+// bytes of each block are carried over to the next, so that matches and letter-boundary tests across
+// block edges come out exactly as with the whole file in memory. Returns an empty vector on failure.
+std::vector<size_t> count_words_streaming(const char* filename, const std::vector<std::string_view>& words, size_t blockSize = STREAM_BLOCK_SIZE);
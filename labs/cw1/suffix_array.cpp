@@ -0,0 +1,234 @@
+#include "suffix_array.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "parallel.h"
+#include "text.h"
+
+// Compare the suffix at position pos with the pattern, on at most pattern.size() characters
+static int compare_suffix(std::string_view text, size_t pos, std::string_view pattern)
+{
+    size_t n = std::min(pattern.size(), text.size() - pos);
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto a = uint8_t(fold_case(text[pos + i]));
+        auto b = uint8_t(fold_case(pattern[i]));
+        if (a != b)
+            return a < b ? -1 : 1;
+    }
+    // A suffix shorter than the pattern sorts before it
+    return n < pattern.size() ? -1 : 0;
+}
+
+bool suffix_array::build(std::string_view data, unsigned numThreads, bool withLcp)
+{
+    text = data;
+    sa.clear();
+    lcp.clear();
+    const size_t n = data.size();
+    if (n >= UINT32_MAX)
+    {
+        std::cerr << "Error: The suffix array needs a corpus under 4 GB" << std::endl;
+        return false;
+    }
+    if (n == 0)
+        return true;
+    if (numThreads == 0)
+        numThreads = default_num_threads();
+    auto numChunks = num_chunks(n, numThreads, PARALLEL_MIN_CHUNK);
+
+    // Suffixes in sorted order so far, with the sort key of the current round
+    struct entry
+    {
+        uint32_t key;
+        uint32_t pos;
+    };
+    auto byKey = [](const entry& lhs, const entry& rhs) { return lhs.key < rhs.key; };
+    std::vector<entry> entries(n);
+    run_chunks(n, numChunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            entries[i] = { uint8_t(fold_case(data[i])), uint32_t(i) };
+    });
+    parallel_sort(entries, byKey, numThreads);
+
+    // rank[i]: 1 + index of the first suffix of suffix i's group, i.e. of the suffixes sharing its first
+    // h characters. 0 is kept for "past the end", which sorts first, as a shorter suffix should.
+    std::vector<uint32_t> rank(n);
+    // Groups of 2+ suffixes, as [first, last) ranges of entries: the only ones left to sort
+    std::vector<std::pair<uint32_t, uint32_t>> groups;
+    for (size_t j = 0, first = 0; j < n; ++j)
+    {
+        if (j > 0 && entries[j].key != entries[j - 1].key)
+            first = j;
+        rank[entries[j].pos] = uint32_t(first + 1);
+        if (j + 1 == n || entries[j + 1].key != entries[j].key)
+            if (j > first)
+                groups.push_back({ uint32_t(first), uint32_t(j + 1) });
+    }
+
+    // Prefix doubling: suffixes sorted by h characters are sorted by 2h by sorting each group on the rank
+    // of the suffix h characters further. The groups are shared out between the threads by size, except
+    // those bigger than half a thread's share (e.g. the suffixes starting with a space in the first
+    // rounds, or nearly all of them on repetitive text): those are each sorted by all the threads.
+    std::vector<size_t> groupOffsets;
+    std::vector<std::pair<uint32_t, uint32_t>> largeGroups;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> newGroups(numThreads + 1);
+    // Assign rank first + 1 to each run of equal keys [first, ...) of the (sorted) group g, and add
+    // the runs of 2+ suffixes to split
+    auto splitGroup = [&](std::pair<uint32_t, uint32_t> g, std::vector<std::pair<uint32_t, uint32_t>>& split) {
+        for (auto j = g.first, first = j; j < g.second; ++j)
+        {
+            if (entries[j].key != entries[first].key)
+                first = j;
+            rank[entries[j].pos] = first + 1;
+            if (j + 1 == g.second || entries[j + 1].key != entries[j].key)
+                if (j > first)
+                    split.push_back({ first, j + 1 });
+        }
+    };
+    for (size_t h = 1; !groups.empty(); h *= 2)
+    {
+        size_t numToSort = 0;
+        for (auto& g : groups)
+            numToSort += g.second - g.first;
+        const size_t largeGroupSize = std::max<size_t>(PARALLEL_MIN_CHUNK / sizeof(entry), numToSort / (2 * numThreads));
+        if (numThreads > 1)
+        {
+            auto isLarge = [&](const std::pair<uint32_t, uint32_t>& g) { return g.second - g.first > largeGroupSize; };
+            std::copy_if(groups.begin(), groups.end(), std::back_inserter(largeGroups), isLarge);
+            groups.erase(std::remove_if(groups.begin(), groups.end(), isLarge), groups.end());
+        }
+
+        groupOffsets.resize(groups.size() + 1);
+        groupOffsets[0] = 0;
+        for (size_t g = 0; g < groups.size(); ++g)
+            groupOffsets[g + 1] = groupOffsets[g] + (groups[g].second - groups[g].first);
+        auto numGroupChunks = std::min<unsigned>(numThreads, unsigned(std::min(groups.size(), groupOffsets.back() / 4096 + 1)));
+        // Groups [first, last) starting in the chunk's share of the suffixes still to sort
+        auto groupsOf = [&](size_t begin, size_t end) {
+            auto first = std::lower_bound(groupOffsets.begin(), groupOffsets.end() - 1, begin) - groupOffsets.begin();
+            auto last = std::lower_bound(groupOffsets.begin(), groupOffsets.end() - 1, end) - groupOffsets.begin();
+            return std::make_pair(size_t(first), size_t(last));
+        };
+
+        // All the keys are read before any rank changes
+        auto setKeys = [&](size_t begin, size_t end) {
+            for (auto j = begin; j < end; ++j)
+            {
+                auto i = entries[j].pos;
+                entries[j].key = i + h < n ? rank[i + h] : 0;
+            }
+        };
+        run_chunks(groupOffsets.back(), numGroupChunks, [&](unsigned, size_t begin, size_t end) {
+            auto range = groupsOf(begin, end);
+            for (auto g = range.first; g < range.second; ++g)
+                setKeys(groups[g].first, groups[g].second);
+        });
+        for (auto& g : largeGroups)
+            run_chunks(g.second - g.first, numThreads, [&](unsigned, size_t begin, size_t end) { setKeys(g.first + begin, g.first + end); });
+
+        run_chunks(groupOffsets.back(), numGroupChunks, [&](unsigned chunk, size_t begin, size_t end) {
+            auto range = groupsOf(begin, end);
+            auto& split = newGroups[chunk];
+            split.clear();
+            for (auto g = range.first; g < range.second; ++g)
+            {
+                std::sort(entries.begin() + groups[g].first, entries.begin() + groups[g].second, byKey);
+                splitGroup(groups[g], split);
+            }
+        });
+        // The ranks of a large group are set on one thread: a linear pass, against the sort's n log n
+        auto& largeSplit = newGroups[numThreads];
+        largeSplit.clear();
+        for (auto& g : largeGroups)
+        {
+            parallel_sort(entries.begin() + g.first, entries.begin() + g.second, byKey, numThreads);
+            splitGroup(g, largeSplit);
+        }
+        largeGroups.clear();
+
+        groups.clear();
+        for (unsigned chunk = 0; chunk < numGroupChunks; ++chunk)
+            groups.insert(groups.end(), newGroups[chunk].begin(), newGroups[chunk].end());
+        groups.insert(groups.end(), largeSplit.begin(), largeSplit.end());
+    }
+
+    // The ranks are only needed again for Kasai, which makes its own: freeing them first keeps the peak
+    // at 12 bytes per corpus byte (entries and ranks while sorting, entries and sa here) instead of 16
+    rank = std::vector<uint32_t>();
+    sa.resize(n);
+    run_chunks(n, numChunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j)
+            sa[j] = entries[j].pos;
+    });
+    entries = std::vector<entry>();
+    if (!withLcp)
+        return true;
+
+    // Kasai: going through the suffixes in text order, the LCP with the previous suffix in sorted order
+    // drops by at most one from one suffix to the next. Each thread takes a range of text positions and
+    // starts from 0, so only the first few suffixes of each range lose the head start.
+    rank.resize(n);
+    for (size_t j = 0; j < n; ++j)
+        rank[sa[j]] = uint32_t(j);
+    lcp.assign(n, 0);
+    run_chunks(n, numChunks, [&](unsigned, size_t begin, size_t end) {
+        size_t h = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            auto r = rank[i];
+            if (r == 0)
+            {
+                h = 0;
+                continue;
+            }
+            size_t prev = sa[r - 1];
+            while (i + h < n && prev + h < n && fold_case(data[i + h]) == fold_case(data[prev + h]))
+                ++h;
+            lcp[r] = uint32_t(h);
+            if (h > 0)
+                --h;
+        }
+    });
+    return true;
+}
+
+std::pair<size_t, size_t> suffix_array::find(std::string_view pattern) const
+{
+    if (pattern.empty())
+        return { 0, sa.size() };
+    // First suffix >= pattern, then first suffix > pattern (on the pattern's length)
+    auto first = std::partition_point(sa.begin(), sa.end(), [&](uint32_t pos) { return compare_suffix(text, pos, pattern) < 0; });
+    auto last = std::partition_point(first, sa.end(), [&](uint32_t pos) { return compare_suffix(text, pos, pattern) == 0; });
+    return { size_t(first - sa.begin()), size_t(last - sa.begin()) };
+}
+
+size_t suffix_array::count_substring(std::string_view pattern) const
+{
+    auto range = find(pattern);
+    return pattern.empty() ? 0 : range.second - range.first;
+}
+
+size_t suffix_array::count_token(std::string_view token) const
+{
+    if (token.empty())
+        return 0;
+    auto range = find(token);
+    size_t count = 0;
+    for (size_t j = range.first; j < range.second; ++j)
+    {
+        size_t pos = sa[j];
+        if (pos > 0 && is_letter(text[pos - 1]))
+            continue;
+        if (pos + token.size() < text.size() && is_letter(text[pos + token.size()]))
+            continue;
+        ++count;
+    }
+    return count;
+}
+
+size_t suffix_array::longest_repeat() const
+{
+    return lcp.empty() ? 0 : *std::max_element(lcp.begin(), lcp.end());
+}
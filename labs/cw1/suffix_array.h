@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Suffix array and LCP array of the lowercased corpus. Any substring, not just whole words, is counted
+// with two binary searches, so thousands of queries per second are cheap once it's built. Indices are
+// 32-bit, so the corpus must be under 4 GB, and the arrays take 8 bytes per corpus byte. Building them
+// peaks at 12 bytes per corpus byte, plus 8 bytes per group of suffixes still tied in a round (about 2
+// more per corpus byte on natural text, up to 7 on very repetitive text). With more than one thread,
+// the sorts of the first round and of the largest groups also need a buffer the size of what they sort
+// (up to 8 bytes per corpus byte).
+class suffix_array
+{
+private:
+    // The corpus (original case; suffixes are compared folded). It must outlive the suffix array
+    std::string_view text;
+    // Start positions of the suffixes, in sorted order
+    std::vector<uint32_t> sa;
+    // lcp[i]: length of the longest common prefix of suffixes sa[i - 1] and sa[i] (lcp[0] = 0)
+    std::vector<uint32_t> lcp;
+public:
+    // Build both arrays by parallel prefix doubling (0 threads: one per hardware thread), the Larsson-Sadakane
+    // way: suffixes sorted by their first h characters are sorted by 2h using the ranks of the previous round,
+    // only re-sorting the groups still tied, so text that's done early stops costing anything. Groups larger
+    // than half a thread's share are sorted by all the threads together. The LCP array then comes from
+    // Kasai's algorithm, split over the threads (skipped if not needed, e.g. for the FM-index).
+    // Prints the error and returns false if the corpus is too large.
+    bool build(std::string_view data, unsigned numThreads = 0, bool withLcp = true);
+
+    // Range [first, last) of the suffix array holding the suffixes that start with the pattern (no case)
+    std::pair<size_t, size_t> find(std::string_view pattern) const;
+
+    // Occurrences of the pattern anywhere, e.g. inside words too
+    size_t count_substring(std::string_view pattern) const;
+
+    // Occurrences not preceded or followed by a letter: same as calc_token_occurrences
+    size_t count_token(std::string_view token) const;
+
+    // Length of the longest substring that occurs at least twice
+    size_t longest_repeat() const;
+
+    // Start position of the i-th smallest suffix
+    size_t position(size_t i) const { return sa[i]; }
+
+    size_t size() const { return sa.size(); }
+    size_t memory_bytes() const { return (sa.size() + lcp.size()) * sizeof(uint32_t); }
+};
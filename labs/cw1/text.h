@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// ASCII helpers shared by all the cw1 scanners. The corpus is never lowercased in memory
+// (it's a read-only mapping), so case is folded on the fly while scanning.
+
+// Lowercase a single ASCII character, leaving everything else untouched (same as std::tolower in the "C" locale)
+inline char fold_case(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c | 0x20) : c;
+}
+
+// A "letter" is an ASCII letter of either case. Anything else delimits words.
+inline bool is_letter(char c)
+{
+    char f = char(c | 0x20);
+    return f >= 'a' && f <= 'z';
+}
+
+// Lowercased copy of a token, so that it can be compared against folded corpus bytes
+inline std::string fold_case(std::string_view token)
+{
+    std::string folded(token);
+    for (auto& c : folded)
+        c = fold_case(c);
+    return folded;
+}
+
+// Compare n corpus bytes against an already folded string, folding the corpus side
+inline bool equals_folded(const char* text, const char* folded, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (fold_case(text[i]) != folded[i])
+            return false;
+    return true;
+}
+
+// Does the (folded) token occur at position i as a whole word? Used by the scanners for the
+// positions that their fast paths can't handle, e.g. the first byte and the tail of the corpus.
+inline bool is_token_at(std::string_view data, size_t i, std::string_view folded)
+{
+    if (i + folded.size() > data.size() || !equals_folded(data.data() + i, folded.data(), folded.size()))
+        return false;
+    if (i > 0 && is_letter(data[i - 1]))
+        return false;
+    auto iSuffix = i + folded.size();
+    return iSuffix >= data.size() || !is_letter(data[iSuffix]);
+}
@@ -0,0 +1,95 @@
+#include "tfidf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string_view>
+
+#include "corpus.h"
+#include "dataset.h"
+#include "parallel.h"
+#include "word_map.h"
+
+bool term_doc_table::build(const std::vector<std::string>& paths, unsigned numThreads)
+{
+    *this = term_doc_table();
+    documents = paths;
+    const size_t numDocs = paths.size();
+    if (numThreads == 0)
+        numThreads = default_num_threads();
+
+    // Documents are handed out largest first, and with fewer documents than threads each document is
+    // itself split between the spare threads
+    std::vector<std::vector<word_count>> vocabularies(numDocs);
+    documentWords.assign(numDocs, 0);
+    std::atomic<bool> ok(true);
+    run_largest_first(file_sizes(paths), numThreads, [&](size_t d, unsigned threadsPerDoc) {
+        corpus text;
+        if (!text.open(paths[d].c_str()))
+        {
+            ok = false;
+            return;
+        }
+        vocabularies[d] = count_words(text.view(), threadsPerDoc);
+        for (auto& wc : vocabularies[d])
+            documentWords[d] += wc.count;
+    });
+    if (!ok)
+        return false;
+
+    // Term list: the union of the (sorted) vocabularies
+    std::vector<std::string_view> allWords;
+    for (auto& vocabulary : vocabularies)
+        for (auto& wc : vocabulary)
+            allWords.push_back(wc.word);
+    std::sort(allWords.begin(), allWords.end());
+    allWords.erase(std::unique(allWords.begin(), allWords.end()), allWords.end());
+    terms.assign(allWords.begin(), allWords.end());
+    allWords = std::vector<std::string_view>();
+
+    // Columns: each vocabulary is walked alongside the term list, both being sorted
+    columnStart.assign(numDocs + 1, 0);
+    for (size_t d = 0; d < numDocs; ++d)
+        columnStart[d + 1] = columnStart[d] + vocabularies[d].size();
+    termIds.resize(columnStart[numDocs]);
+    termCounts.resize(columnStart[numDocs]);
+    run_chunks(numDocs, unsigned(std::min<size_t>(numThreads, std::max<size_t>(1, numDocs))), [&](unsigned, size_t begin, size_t end) {
+        for (size_t d = begin; d < end; ++d)
+        {
+            size_t t = 0;
+            for (size_t i = 0; i < vocabularies[d].size(); ++i)
+            {
+                while (terms[t] != vocabularies[d][i].word)
+                    ++t;
+                termIds[columnStart[d] + i] = uint32_t(t);
+                termCounts[columnStart[d] + i] = vocabularies[d][i].count;
+            }
+        }
+    });
+
+    documentFrequency.assign(terms.size(), 0);
+    for (auto t : termIds)
+        ++documentFrequency[t];
+    return true;
+}
+
+double term_doc_table::idf(size_t t) const
+{
+    return std::log(double(documents.size()) / double(documentFrequency[t]));
+}
+
+std::vector<scored_term> term_doc_table::top_terms(size_t d, size_t k) const
+{
+    std::vector<scored_term> scored;
+    if (documentWords[d] == 0)
+        return scored;
+    for (size_t i = columnStart[d]; i < columnStart[d + 1]; ++i)
+        scored.push_back({ terms[termIds[i]], termCounts[i], double(termCounts[i]) / double(documentWords[d]) * idf(termIds[i]) });
+    auto better = [](const scored_term& lhs, const scored_term& rhs) {
+        return lhs.score != rhs.score ? lhs.score > rhs.score : lhs.term < rhs.term;
+    };
+    k = std::min(k, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + k, scored.end(), better);
+    scored.resize(k);
+    return scored;
+}
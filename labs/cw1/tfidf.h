@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A term of a document and how much it characterizes it
+struct scored_term
+{
+    std::string term;
+    uint64_t count;
+    // tf-idf: count / words of the document * log(documents / documents containing the term)
+    double score;
+};
+
+// Term x document count table of a set of documents (one per corpus file), for relevance ranking.
+// Stored by column: each document's terms are a sorted run of term ids with their counts, so a
+// document's statistics are contiguous and the (mostly zero) cells of the full table aren't stored.
+class term_doc_table
+{
+private:
+    // Every distinct word of any document (lowercased), sorted
+    std::vector<std::string> terms;
+    // Number of documents each term occurs in
+    std::vector<uint32_t> documentFrequency;
+    std::vector<std::string> documents;
+    // Number of words of each document
+    std::vector<uint64_t> documentWords;
+    // Column of document d: termIds/termCounts[columnStart[d], columnStart[d + 1])
+    std::vector<size_t> columnStart;
+    std::vector<uint32_t> termIds;
+    std::vector<uint64_t> termCounts;
+public:
+    // Tokenize the documents concurrently (0 threads: one per hardware thread), each into per-thread
+    // word maps merged per document, then merge the documents' vocabularies into the term list and
+    // the columns. Prints the error and returns false if a document can't be read.
+    bool build(const std::vector<std::string>& paths, unsigned numThreads = 0);
+
+    size_t num_terms() const { return terms.size(); }
+    size_t num_documents() const { return documents.size(); }
+    const std::string& term(size_t t) const { return terms[t]; }
+    const std::string& document(size_t d) const { return documents[d]; }
+    uint32_t document_frequency(size_t t) const { return documentFrequency[t]; }
+    uint64_t document_words(size_t d) const { return documentWords[d]; }
+    // Distinct terms of a document
+    size_t document_terms(size_t d) const { return columnStart[d + 1] - columnStart[d]; }
+
+    // log(documents / documents containing the term): 0 for terms found in every document
+    double idf(size_t t) const;
+
+    // The k terms with the highest tf-idf in a document, best first (ties in alphabetical order)
+    std::vector<scored_term> top_terms(size_t d, size_t k) const;
+};
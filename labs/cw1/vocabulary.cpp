@@ -0,0 +1,34 @@
+#include "vocabulary.h"
+
+#include "text.h"
+
+bool wildcard_match(std::string_view pattern, std::string_view word)
+{
+    // Greedy matching with backtracking to the last '*': linear unless there are many stars
+    size_t p = 0, w = 0;
+    size_t starP = std::string_view::npos, starW = 0;
+    while (w < word.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || fold_case(pattern[p]) == fold_case(word[w])))
+        {
+            ++p;
+            ++w;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            // Let the star match nothing for now, and remember where to extend it from
+            starP = p++;
+            starW = w;
+        }
+        else if (starP != std::string_view::npos)
+        {
+            p = starP + 1;
+            w = ++starW;
+        }
+        else
+            return false;
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
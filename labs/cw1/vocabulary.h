@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text.h"
+#include "word_map.h"
+
+// Sorted vocabulary of a corpus with the count of every word, built with a single tokenization
+// pass. Prefix and wildcard queries are answered from it without going back to the text.
+class vocabulary
+{
+private:
+    std::vector<word_count> entries;
+public:
+    vocabulary() { }
+    // Tokenize the corpus in parallel (0 threads: one per hardware thread)
+    explicit vocabulary(std::string_view data, unsigned numThreads = 0) : entries(count_words(data, numThreads)) { }
+
+    size_t size() const { return entries.size(); }
+    std::string_view word(size_t i) const { return entries[i].word; }
+    uint64_t count_at(size_t i) const { return entries[i].count; }
+};
+
+// Does a (lowercased) word match a pattern, where '*' stands for any sequence of characters and '?'
+// for exactly one? The pattern is compared without case.
+bool wildcard_match(std::string_view pattern, std::string_view word);
+
+// Total count of the words matching a pattern (see wildcard_match), optionally listing them. Works
+// on anything with a sorted vocabulary: size(), word(i) (lowercased) and count_at(i), i.e. both
+// vocabulary and word_index. Only the range of words starting with the literal prefix of the pattern
+// (up to the first wildcard) is looked at, found by binary search, so "lov*" costs two binary searches
+// and a sum over the matching words.
+template<typename V>
+uint64_t count_matching(const V& vocab, std::string_view pattern, std::vector<word_count>* matches = nullptr)
+{
+    auto folded = fold_case(pattern);
+    auto prefix = std::string_view(folded).substr(0, folded.find_first_of("*?"));
+    bool literal = prefix.size() == folded.size();
+
+    // [first, last) is the range of words starting with the prefix
+    size_t first = 0, last = vocab.size();
+    {
+        size_t lo = 0, hi = vocab.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (vocab.word(mid) < prefix)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        first = lo;
+        hi = vocab.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (vocab.word(mid).substr(0, prefix.size()) == prefix)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        last = lo;
+    }
+
+    uint64_t total = 0;
+    for (size_t i = first; i < last; ++i)
+    {
+        auto word = vocab.word(i);
+        if (literal ? word.size() != prefix.size() : !wildcard_match(folded, word))
+            continue;
+        total += vocab.count_at(i);
+        if (matches)
+            matches->push_back({ std::string(word), vocab.count_at(i) });
+    }
+    return total;
+}
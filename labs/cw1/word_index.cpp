@@ -0,0 +1,196 @@
+#include "word_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "hash.h"
+#include "parallel.h"
+
+namespace fs = std::filesystem;
+
+static const char INDEX_MAGIC[8] = { 'C', 'W', '1', 'I', 'N', 'D', 'E', 'X' };
+static const uint32_t INDEX_VERSION = 1;
+// The content hash is made of independent per-block hashes, so it doesn't depend on the thread count
+static const size_t HASH_BLOCK_SIZE = 1 << 20;
+
+static size_t align8(size_t n)
+{
+    return (n + 7) & ~size_t(7);
+}
+
+static int64_t modification_time(const char* path)
+{
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    return ec ? 0 : int64_t(time.time_since_epoch().count());
+}
+
+uint64_t hash_corpus(std::string_view data, unsigned numThreads)
+{
+    size_t numBlocks = (data.size() + HASH_BLOCK_SIZE - 1) / HASH_BLOCK_SIZE;
+    std::vector<uint64_t> blockHashes(numBlocks);
+    // Chunks here are ranges of blocks
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    run_chunks(numBlocks, numChunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+        {
+            auto block = data.substr(b * HASH_BLOCK_SIZE, HASH_BLOCK_SIZE);
+            blockHashes[b] = hash_bytes(block.data(), block.size(), b);
+        }
+    });
+    return hash_bytes(reinterpret_cast<const char*>(blockHashes.data()), blockHashes.size() * sizeof(uint64_t), data.size());
+}
+
+std::string index_path_for(const std::string& corpusPath)
+{
+    return corpusPath + ".cw1idx";
+}
+
+bool build_word_index(const char* corpusPath, const char* indexPath, unsigned numThreads)
+{
+    corpus text;
+    if (!text.open(corpusPath))
+        return false;
+    auto vocabulary = count_words(text.view(), numThreads);
+
+    word_index_header header = {};
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.sourceSize = text.size();
+    header.sourceTime = modification_time(corpusPath);
+    header.sourceHash = hash_corpus(text.view(), numThreads);
+    header.numWords = vocabulary.size();
+    // Keep the hash table at most half full, so probe sequences stay short
+    header.numSlots = 1;
+    while (header.numSlots < 2 * vocabulary.size())
+        header.numSlots *= 2;
+
+    std::vector<word_index_entry> entries(vocabulary.size());
+    std::vector<uint32_t> slots(header.numSlots, 0);
+    std::string strings;
+    for (size_t i = 0; i < vocabulary.size(); ++i)
+    {
+        const auto& word = vocabulary[i].word;
+        entries[i] = { strings.size(), uint32_t(word.size()), 0, vocabulary[i].count };
+        strings += word;
+        auto slot = hash_folded(word) & (header.numSlots - 1);
+        while (slots[slot] != 0)
+            slot = (slot + 1) & (header.numSlots - 1);
+        slots[slot] = uint32_t(i + 1);
+    }
+    header.stringsSize = strings.size();
+
+    // Written to a temporary file, then renamed over the old index: a process that has the old one
+    // mapped keeps reading it unharmed, and an interrupted write never leaves a torn index behind
+    auto tempPath = std::string(indexPath) + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "Error: Could not create the index file " << tempPath << std::endl;
+        return false;
+    }
+    const char padding[8] = {};
+    auto write_section = [&](const void* data, size_t size) {
+        file.write(static_cast<const char*>(data), size);
+        file.write(padding, align8(size) - size);
+    };
+    write_section(&header, sizeof(header));
+    write_section(entries.data(), entries.size() * sizeof(word_index_entry));
+    write_section(slots.data(), slots.size() * sizeof(uint32_t));
+    write_section(strings.data(), strings.size());
+    file.flush();
+    std::error_code ec;
+    if (!file)
+    {
+        std::cerr << "Error: Could not write the index file " << tempPath << std::endl;
+        file.close();
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    file.close();
+    fs::rename(tempPath, indexPath, ec);
+    if (ec)
+    {
+        std::cerr << "Error: Could not replace the index file " << indexPath << ": " << ec.message() << std::endl;
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    std::cout << "Indexed " << vocabulary.size() << " distinct words of " << corpusPath << " into " << indexPath << std::endl;
+    return true;
+}
+
+bool word_index::open(const char* indexPath)
+{
+    header = nullptr;
+    if (!file.open(indexPath))
+        return false;
+    auto h = reinterpret_cast<const word_index_header*>(file.data());
+    bool valid = file.size() >= sizeof(word_index_header)
+        && memcmp(h->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+        && h->version == INDEX_VERSION;
+    // The section sizes must fit in the file (checked one by one, so that they can't overflow), and the
+    // hash table must be a power of two with an empty slot, or a lookup could index past it or never end
+    valid = valid && h->numWords <= file.size() / sizeof(word_index_entry) && h->numSlots <= file.size() / sizeof(uint32_t)
+        && h->stringsSize <= file.size() && h->numSlots > h->numWords && (h->numSlots & (h->numSlots - 1)) == 0;
+    if (valid)
+    {
+        size_t entriesOffset = align8(sizeof(word_index_header));
+        size_t slotsOffset = entriesOffset + align8(size_t(h->numWords) * sizeof(word_index_entry));
+        size_t stringsOffset = slotsOffset + align8(size_t(h->numSlots) * sizeof(uint32_t));
+        valid = stringsOffset + h->stringsSize <= file.size();
+        entries = reinterpret_cast<const word_index_entry*>(file.data() + entriesOffset);
+        slots = reinterpret_cast<const uint32_t*>(file.data() + slotsOffset);
+        strings = file.data() + stringsOffset;
+    }
+    // Every slot must point at an entry (with at most numWords slots used, so one is left empty), and
+    // every entry into the strings: a linear pass over the vocabulary, nothing next to reading the corpus
+    size_t usedSlots = 0;
+    for (size_t i = 0; valid && i < h->numSlots; ++i)
+    {
+        valid = slots[i] <= h->numWords;
+        usedSlots += slots[i] != 0;
+    }
+    valid = valid && usedSlots <= h->numWords;
+    for (size_t i = 0; valid && i < h->numWords; ++i)
+        valid = entries[i].offset <= h->stringsSize && entries[i].length <= h->stringsSize - entries[i].offset;
+    if (!valid)
+    {
+        std::cerr << "Error: " << indexPath << " is not a valid word index" << std::endl;
+        file.close();
+        return false;
+    }
+    header = h;
+    return true;
+}
+
+bool word_index::is_fresh_for(const char* corpusPath) const
+{
+    if (!header)
+        return false;
+    std::error_code ec;
+    auto size = fs::file_size(corpusPath, ec);
+    if (ec || size != header->sourceSize)
+        return false;
+    if (modification_time(corpusPath) == header->sourceTime)
+        return true;
+    // Touched or copied, but maybe not changed
+    corpus text;
+    return text.open(corpusPath) && hash_corpus(text.view()) == header->sourceHash;
+}
+
+uint64_t word_index::count(std::string_view word) const
+{
+    if (!header || word.empty())
+        return 0;
+    auto mask = header->numSlots - 1;
+    for (auto slot = hash_folded(word) & mask; slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const auto& entry = entries[slots[slot] - 1];
+        if (entry.length == word.size() && equals_folded(word.data(), strings + entry.offset, word.size()))
+            return entry.count;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "corpus.h"
+#include "word_map.h"
+
+// On-disk word frequency index of a corpus, so that later runs can answer word counts without
+// reading the text at all.
+//
+// File layout (native endianness, every section 8-byte aligned):
+//     word_index_header
+//     word_index_entry[numWords]    sorted by word, so ranges of words can be binary searched
+//     uint32_t[numSlots]            open-addressing hash table (linear probing) of entry index + 1, 0 = empty
+//     char[stringsSize]             the (lowercased) words, back to back
+// The header records the size, modification time and content hash of the source corpus, to tell
+// whether the index is stale.
+
+struct word_index_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint64_t numWords;
+    uint64_t numSlots;
+    uint64_t stringsSize;
+};
+
+struct word_index_entry
+{
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+// Content hash of a corpus, as stored in the index header. Computed in parallel, but independent of the thread count
+uint64_t hash_corpus(std::string_view data, unsigned numThreads = 0);
+
+// Where the index of a corpus lives by default: next to it, with an extra extension
+std::string index_path_for(const std::string& corpusPath);
+
+// Tokenize the corpus and write its index. Prints the error and returns false on failure
+bool build_word_index(const char* corpusPath, const char* indexPath, unsigned numThreads = 0);
+
+// A memory mapped index file. Opening it checks the sections against the file size, in time linear in
+// the vocabulary (not the corpus), and every lookup is O(1).
+class word_index
+{
+private:
+    corpus file;
+    const word_index_header* header = nullptr;
+    const word_index_entry* entries = nullptr;
+    const uint32_t* slots = nullptr;
+    const char* strings = nullptr;
+public:
+    // Map the index and check its format, so that a truncated or corrupt file is rejected rather than
+    // read out of bounds. Prints the error and returns false on failure
+    bool open(const char* indexPath);
+
+    // Was the index built from the current contents of this corpus? Size and modification time are
+    // checked first; the content hash only needs computing if the size matches but the time doesn't.
+    bool is_fresh_for(const char* corpusPath) const;
+
+    // Occurrences of a word, which must consist of letters only (see is_word)
+    uint64_t count(std::string_view word) const;
+
+    // The vocabulary, in sorted order
+    size_t size() const { return header ? size_t(header->numWords) : 0; }
+    std::string_view word(size_t i) const { return { strings + entries[i].offset, entries[i].length }; }
+    uint64_t count_at(size_t i) const { return entries[i].count; }
+};
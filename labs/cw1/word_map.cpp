@@ -0,0 +1,123 @@
+#include "word_map.h"
+
+#include <algorithm>
+#include <queue>
+
+#include "hash.h"
+#include "parallel.h"
+#include "words.h"
+
+word_map::word_map(size_t initialCapacity)
+{
+    size_t capacity = 16;
+    while (capacity < initialCapacity)
+        capacity *= 2;
+    slots.assign(capacity, slot{ nullptr, 0, 0, 0 });
+}
+
+void word_map::grow()
+{
+    std::vector<slot> old(slots.size() * 2, slot{ nullptr, 0, 0, 0 });
+    old.swap(slots);
+    used = 0;
+    for (auto& s : old)
+        if (s.ptr)
+            add(std::string_view(s.ptr, s.length), s.count);
+}
+
+void word_map::add(std::string_view word, uint64_t n)
+{
+    // Keep the table at most 70% full, so probe sequences stay short
+    if ((used + 1) * 10 > slots.size() * 7)
+        grow();
+    auto hash = hash_folded(word);
+    auto tag = uint32_t(hash >> 32);
+    auto mask = slots.size() - 1;
+    for (auto i = size_t(hash) & mask;; i = (i + 1) & mask)
+    {
+        auto& s = slots[i];
+        if (!s.ptr)
+        {
+            s = { word.data(), uint32_t(word.size()), tag, n };
+            ++used;
+            return;
+        }
+        if (s.tag == tag && s.length == word.size() && folded_equal()(std::string_view(s.ptr, s.length), word))
+        {
+            s.count += n;
+            return;
+        }
+    }
+}
+
+void word_map::merge(const word_map& other)
+{
+    other.for_each([this](std::string_view word, uint64_t n) { add(word, n); });
+}
+
+uint64_t word_map::count(std::string_view word) const
+{
+    auto hash = hash_folded(word);
+    auto tag = uint32_t(hash >> 32);
+    auto mask = slots.size() - 1;
+    for (auto i = size_t(hash) & mask; slots[i].ptr; i = (i + 1) & mask)
+    {
+        auto& s = slots[i];
+        if (s.tag == tag && s.length == word.size() && folded_equal()(std::string_view(s.ptr, s.length), word))
+            return s.count;
+    }
+    return 0;
+}
+
+word_map count_word_map(std::string_view data, unsigned numThreads)
+{
+    auto numChunks = num_chunks(data.size(), numThreads, PARALLEL_MIN_CHUNK);
+    std::vector<word_map> maps(numChunks);
+    run_chunks(data.size(), numChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& map = maps[chunk];
+        for_each_word(data, begin, end, [&](std::string_view word) { map.add(word); });
+    });
+    for (unsigned i = 1; i < numChunks; ++i)
+        maps[0].merge(maps[i]);
+    return std::move(maps[0]);
+}
+
+std::vector<word_count> count_words(std::string_view data, unsigned numThreads)
+{
+    auto map = count_word_map(data, numThreads);
+    std::vector<word_count> vocabulary;
+    vocabulary.reserve(map.size());
+    map.for_each([&](std::string_view word, uint64_t n) { vocabulary.push_back({ fold_case(word), n }); });
+    std::sort(vocabulary.begin(), vocabulary.end(), [](const word_count& lhs, const word_count& rhs) { return lhs.word < rhs.word; });
+    return vocabulary;
+}
+
+std::vector<word_count> top_k(const word_map& map, size_t k)
+{
+    // "Better" = more frequent, or as frequent and alphabetically first
+    using candidate = std::pair<uint64_t, std::string>;
+    auto better = [](const candidate& lhs, const candidate& rhs) {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    };
+    // Min-heap of the best k so far: the top is the one to evict
+    std::priority_queue<candidate, std::vector<candidate>, decltype(better)> heap(better);
+    if (k == 0)
+        return {};
+    map.for_each([&](std::string_view word, uint64_t n) {
+        if (heap.size() == k && n < heap.top().first)
+            return;
+        candidate c(n, fold_case(word));
+        if (heap.size() < k)
+            heap.push(std::move(c));
+        else if (better(c, heap.top()))
+        {
+            heap.pop();
+            heap.push(std::move(c));
+        }
+    });
+
+    std::vector<word_count> result(heap.size());
+    for (size_t i = heap.size(); i-- > 0; heap.pop())
+        result[i] = { heap.top().second, heap.top().first };
+    return result;
+}
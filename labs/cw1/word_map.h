@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Word -> count hash map for tokenizing a corpus. Keys are views of the corpus itself (compared without
+// case), so no string is allocated per word, and the table is a single flat array probed linearly,
+// so a lookup is usually one cache miss. The corpus must outlive the map.
+class word_map
+{
+private:
+    struct slot
+    {
+        // nullptr: empty slot
+        const char* ptr;
+        uint32_t length;
+        // Top bits of the hash, to skip most of the string compares on collisions
+        uint32_t tag;
+        uint64_t count;
+    };
+    std::vector<slot> slots;
+    size_t used = 0;
+
+    void grow();
+public:
+    explicit word_map(size_t initialCapacity = 1024);
+
+    // Add n occurrences of a word
+    void add(std::string_view word, uint64_t n = 1);
+    // Add all the counts of another map
+    void merge(const word_map& other);
+
+    // Occurrences of a word (any case)
+    uint64_t count(std::string_view word) const;
+    // Number of distinct words
+    size_t size() const { return used; }
+
+    // Call f(word, count) for every distinct word, in no particular order. The word is a view of
+    // whichever occurrence was seen first, in its original case.
+    template<typename F>
+    void for_each(F&& f) const
+    {
+        for (auto& s : slots)
+            if (s.ptr)
+                f(std::string_view(s.ptr, s.length), s.count);
+    }
+};
+
+// A word of the corpus (lowercased) and the number of times it occurs
+struct word_count
+{
+    std::string word;
+    uint64_t count;
+};
+
+// Tokenize the corpus in parallel (0 threads: one per hardware thread): every thread counts the words
+// of its chunk into its own map, and the maps are merged at the end.
+word_map count_word_map(std::string_view data, unsigned numThreads = 0);
+
+// Count every distinct word of the corpus. The result is sorted by word.
+std::vector<word_count> count_words(std::string_view data, unsigned numThreads = 0);
+
+// The k most frequent words, most frequent first (ties in alphabetical order). Selected with a bounded
+// heap, so only k words are ever kept aside.
+std::vector<word_count> top_k(const word_map& map, size_t k);
@@ -0,0 +1,65 @@
+#include "words.h"
+
+#include "search.h"
+#include "simd.h"
+
+// Bit i set if p[i] is a letter, for the n <= 64 bytes from p
+static uint64_t letter_mask_scalar(const char* p, size_t n)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < n; ++i)
+        mask |= uint64_t(is_letter(p[i])) << i;
+    return mask;
+}
+
+#ifdef CW1_X86
+
+static uint64_t letter_mask_sse2(const char* p)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i)
+        mask |= uint64_t(uint32_t(_mm_movemask_epi8(letters_sse2(_mm_loadu_si128((const __m128i*)(p + 16 * i)))))) << (16 * i);
+    return mask;
+}
+
+CW1_TARGET_AVX2 static uint64_t letter_mask_avx2(const char* p)
+{
+    uint64_t low = uint32_t(_mm256_movemask_epi8(letters_avx2(_mm256_loadu_si256((const __m256i*)p))));
+    uint64_t high = uint32_t(_mm256_movemask_epi8(letters_avx2(_mm256_loadu_si256((const __m256i*)(p + 32)))));
+    return low | (high << 32);
+}
+
+#endif
+
+void word_boundaries(std::string_view data, size_t begin, size_t numBlocks, uint64_t* starts, uint64_t* ends)
+{
+    const size_t size = data.size();
+    const auto level = best_simd_level();
+    // Letter masks first (in ends), then the boundaries, which need the first bit of the next block
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+        size_t base = begin + 64 * b;
+        if (base + 64 > size)
+            ends[b] = base < size ? letter_mask_scalar(data.data() + base, size - base) : 0;
+#ifdef CW1_X86
+        else if (level == simd_level::avx2)
+            ends[b] = letter_mask_avx2(data.data() + base);
+        else if (level == simd_level::sse2)
+            ends[b] = letter_mask_sse2(data.data() + base);
+#endif
+        else
+            ends[b] = letter_mask_scalar(data.data() + base, 64);
+    }
+    (void)level;
+
+    uint64_t before = begin > 0 && begin - 1 < size && is_letter(data[begin - 1]);
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+        uint64_t letters = ends[b];
+        size_t next = begin + 64 * (b + 1);
+        uint64_t after = b + 1 < numBlocks ? ends[b + 1] & 1 : (next < size && is_letter(data[next]));
+        starts[b] = letters & ~((letters << 1) | before);
+        ends[b] = letters & ~((letters >> 1) | (after << 63));
+        before = letters >> 63;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "bits.h"
+#include "text.h"
+
+// A word is a maximal run of letters. This is exactly what calc_token_occurrences matches when it's
+// given an all-letter token, so counting words answers the same question.
+
+// Does the token consist of letters only, i.e. can it be answered by counting words?
+inline bool is_word(std::string_view token)
+{
+    if (token.empty())
+        return false;
+    for (char c : token)
+        if (!is_letter(c))
+            return false;
+    return true;
+}
+
+// Packed bitmaps of the word boundaries of numBlocks blocks of 64 bytes from begin: bit i of starts[b]
+// is set if a word starts at begin + 64 * b + i, bit i of ends[b] if a word's last letter is there.
+// Bytes past the end of the data count as non-letters. The letter tests are done with SIMD range
+// compares, 32 or 16 bytes at a time, so tokenizing becomes bit-scan loops over the bitmaps.
+void word_boundaries(std::string_view data, size_t begin, size_t numBlocks, uint64_t* starts, uint64_t* ends);
+
+// Call f(word) for every word that starts in [begin, end), in order. A word that starts in the range is
+// passed whole even if it runs past the end, and a word that started before the range is skipped,
+// so adjacent ranges see every word exactly once.
+template<typename F>
+void for_each_word(std::string_view data, size_t begin, size_t end, F&& f)
+{
+    constexpr size_t BATCH_BLOCKS = 64;
+    uint64_t starts[BATCH_BLOCKS], ends[BATCH_BLOCKS];
+    end = end < data.size() ? end : data.size();
+    // Start of the word whose end hasn't been found yet, if any
+    size_t wordStart = SIZE_MAX;
+    for (size_t base = begin, numBlocks = 0; base < end || wordStart != SIZE_MAX; base += 64 * numBlocks)
+    {
+        // Only the blocks up to the end, then one at a time for the rest of the last word
+        numBlocks = base < end ? (end - base + 63) / 64 : 1;
+        numBlocks = numBlocks < BATCH_BLOCKS ? numBlocks : BATCH_BLOCKS;
+        word_boundaries(data, base, numBlocks, starts, ends);
+        for (size_t b = 0; b < numBlocks; ++b)
+        {
+            size_t blockBase = base + 64 * b;
+            uint64_t s = starts[b], e = ends[b];
+            // Starts and ends alternate, a one-letter word having both on the same bit
+            for (;;)
+            {
+                if (wordStart == SIZE_MAX)
+                {
+                    if (!s)
+                        break;
+                    int bit = count_trailing_zeros(s);
+                    if (blockBase + bit >= end)
+                        return;
+                    s &= s - 1;
+                    // Ends before the start belong to a word that started before the range
+                    e &= ~uint64_t(0) << bit;
+                    wordStart = blockBase + bit;
+                }
+                if (!e)
+                    break;
+                size_t wordEnd = blockBase + count_trailing_zeros(e) + 1;
+                e &= e - 1;
+                f(data.substr(wordStart, wordEnd - wordStart));
+                wordStart = SIZE_MAX;
+            }
+            if (wordStart == SIZE_MAX && blockBase + 64 >= end)
+                return;
+        }
+    }
+}
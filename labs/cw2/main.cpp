@@ -4,10 +4,14 @@
 // Headers
 ////////////////////////////////////////////////////////////
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <ctime>
 #include <cstdlib>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -84,6 +88,82 @@ void static_sort(std::vector<std::string>& filenames)
     });
 }
 
+// The filenames in median order, while the medians are still being computed: the images analysed so far
+// come first, sorted, and the rest follow in directory order until their turn comes. Workers insert
+// under a mutex, and the render loop only copies the order out if it can take the lock straight away,
+// so a frame never waits for a worker.
+class sorted_images
+{
+public:
+    explicit sorted_images(std::vector<std::string> filenames) : order(std::move(filenames)) {}
+
+    // Move an analysed image from the pending ones to its place among the sorted ones
+    void insert(const std::string& filename, double median)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto pending = std::find(order.begin() + medians.size(), order.end(), filename);
+        if (pending == order.end())
+            return;
+        order.erase(pending);
+        auto pos = std::upper_bound(medians.begin(), medians.end(), median) - medians.begin();
+        medians.insert(medians.begin() + pos, median);
+        order.insert(order.begin() + pos, filename);
+        ++version;
+    }
+
+    // Copy the order out if it changed since lastVersion and no worker holds the lock, otherwise leave
+    // the caller's copy as it is
+    bool try_snapshot(std::vector<std::string>& snapshot, size_t& numSorted, unsigned& lastVersion) const
+    {
+        if (version == lastVersion)
+            return false;
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return false;
+        snapshot = order;
+        numSorted = medians.size();
+        lastVersion = version;
+        return true;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::string> order;
+    std::vector<double> medians;
+    std::atomic<unsigned> version = 0;
+};
+
+// Worker threads that decode the images and compute their medians in the background, one image at a
+// time off a shared counter, and insert them into a sorted_images as they finish. Stopped (after the
+// images in progress) and joined when destroyed, e.g. if the window is closed before they're done.
+class background_sort
+{
+public:
+    background_sort(const std::vector<std::string>& filenames, sorted_images& sorted) : filenames(filenames)
+    {
+        auto numThreads = std::max(1u, std::thread::hardware_concurrency());
+        numThreads = unsigned(std::min<size_t>(numThreads, filenames.size()));
+        for (unsigned i = 0; i < numThreads; ++i)
+            threads.emplace_back([this, &sorted] {
+                for (size_t i = next++; i < this->filenames.size() && !stop; i = next++)
+                    sorted.insert(this->filenames[i], filename_to_median(this->filenames[i]));
+            });
+    }
+
+    ~background_sort()
+    {
+        stop = true;
+        for (auto& t : threads)
+            t.join();
+    }
+
+private:
+    std::vector<std::string> filenames;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> stop = false;
+};
+
 sf::Vector2f SpriteScaleFromDimensions(const sf::Vector2u& textureSize, int screenWidth, int screenHeight)
 {
     float scaleX = screenWidth / float(textureSize.x);
@@ -106,11 +186,19 @@ int main()
     std::vector<std::string> imageFilenames;
     for (auto& p : fs::directory_iterator(image_folder))
         imageFilenames.push_back(p.path().u8string());
+    if (imageFilenames.empty())
+    {
+        printf("No images found in \"%s\"\n", image_folder);
+        return -1;
+    }
 
-    ///////////////////////////////////////////////////////////////////////////////////////////////
-    //  YOUR CODE HERE INSTEAD, TO ORDER THE IMAGES IN A MULTI-THREADED MANNER WITHOUT BLOCKING  //
-    ///////////////////////////////////////////////////////////////////////////////////////////////
-    static_sort(imageFilenames);
+    // Sort in the background: the window opens straight away, and the images move to their place as
+    // their medians come in. The render loop works on its own copy of the order, refreshed when it can.
+    sorted_images sortedImages(imageFilenames);
+    background_sort sorter(imageFilenames, sortedImages);
+    std::vector<std::string> order = imageFilenames;
+    size_t numSorted = 0;
+    unsigned orderVersion = 0;
 
     // Define some constants
     const int gameWidth = 800;
@@ -125,8 +213,15 @@ int main()
 
     // Load an image to begin with
     sf::Texture texture;
-    if (!texture.loadFromFile(imageFilenames[imageIndex]))
+    if (!texture.loadFromFile(order[imageIndex]))
         return EXIT_FAILURE;
+    // The image on screen stays the same while the order changes under it, only its index moves
+    std::string imageFilename = order[imageIndex];
+    auto updateTitle = [&] {
+        window.setTitle(imageFilename + " (" + std::to_string(imageIndex + 1) + "/" + std::to_string(order.size()) + ", "
+                        + std::to_string(numSorted) + " sorted)");
+    };
+    updateTitle();
     sf::Sprite sprite (texture);
     // Make sure the texture fits the screen
     sprite.setScale(SpriteScaleFromDimensions(texture.getSize(),gameWidth,gameHeight));
@@ -134,6 +229,13 @@ int main()
     sf::Clock clock;
     while (window.isOpen())
     {
+        // Pick up the latest order, if the workers have moved on and aren't holding it right now
+        if (sortedImages.try_snapshot(order, numSorted, orderVersion))
+        {
+            imageIndex = int(std::find(order.begin(), order.end(), imageFilename) - order.begin());
+            updateTitle();
+        }
+
         // Handle events
         sf::Event event;
         while (window.pollEvent(event))
@@ -160,13 +262,13 @@ int main()
             {
                 // adjust the image index
                 if (event.key.code == sf::Keyboard::Key::Left)
-                    imageIndex = (imageIndex + imageFilenames.size() - 1) % imageFilenames.size();
+                    imageIndex = (imageIndex + order.size() - 1) % order.size();
                 else if (event.key.code == sf::Keyboard::Key::Right)
-                    imageIndex = (imageIndex + 1) % imageFilenames.size();
+                    imageIndex = (imageIndex + 1) % order.size();
                 // get image filename
-                const auto& imageFilename = imageFilenames[imageIndex];
+                imageFilename = order[imageIndex];
                 // set it as the window title 
-                window.setTitle(imageFilename);
+                updateTitle();
                 // ... and load the appropriate texture, and put it in the sprite
                 if (texture.loadFromFile(imageFilename))
                 {